@@ -0,0 +1,275 @@
+// Scaling benchmark for AsyncHttpClient event-loop sharding.
+//
+// Starts an in-process loopback HTTP server (epoll, keep-alive, fixed 200
+// response) listening on several ports, so requests spread over several
+// host:port shards, then measures throughput and latency for 1, 2, 4, ...
+// event loops up to --max-loops. Loop i is pinned to CPU i.
+//
+// --unix also serves the same responses on an abstract Unix socket and runs
+// every step over both transports, to measure what leaving the TCP stack
+// saves for a local sidecar.
+//
+// Usage: async_scaling [--max-loops N] [--requests N] [--window N]
+//                      [--ports N] [--server-threads N] [--no-steal] [--unix]
+#include "async_http_client.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class LoopbackServer {
+public:
+    // unix_name: abstract socket to serve as well; "" = TCP only
+    LoopbackServer(size_t ports, size_t threads, const std::string& unix_name) {
+        for (size_t i = 0; i < ports; ++i) listeners_.push_back(listen_any());
+        if (!unix_name.empty()) listeners_.push_back(listen_abstract(unix_name));
+        tcp_listeners_ = ports;
+        for (size_t t = 0; t < threads; ++t) {
+            const int ep = epoll_create1(0);
+            for (int fd : listeners_) {
+                epoll_event ev{};
+                ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+                ev.data.fd = -fd - 1;  // negative marks a listener
+                epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+            }
+            epolls_.push_back(ep);
+            workers_.emplace_back([this, ep]{ serve(ep); });
+        }
+    }
+
+    ~LoopbackServer() {
+        stop_ = true;
+        for (auto& w : workers_) w.join();
+        for (int ep : epolls_) close(ep);
+        for (int fd : listeners_) close(fd);
+    }
+
+    std::vector<int> ports() const {
+        std::vector<int> out;
+        for (size_t i = 0; i < tcp_listeners_; ++i) {
+            const int fd = listeners_[i];
+            sockaddr_in addr{};
+            socklen_t len = sizeof(addr);
+            getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+            out.push_back(ntohs(addr.sin_port));
+        }
+        return out;
+    }
+
+private:
+    static int listen_any() {
+        const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        const int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4096) != 0) {
+            std::perror("listen");
+            std::exit(1);
+        }
+        return fd;
+    }
+
+    static int listen_abstract(const std::string& name) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        // Leading NUL = abstract namespace: no file to clean up
+        const size_t n = std::min(name.size(), sizeof(addr.sun_path) - 1);
+        std::memcpy(addr.sun_path + 1, name.data(), n);
+        const auto len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + n);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(fd, 4096) != 0) {
+            std::perror("listen unix");
+            std::exit(1);
+        }
+        return fd;
+    }
+
+    void serve(int ep) {
+        static const char kReply[] =
+            "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nContent-Type: text/plain\r\n\r\nok";
+        std::unordered_map<int, std::string> pending;
+        epoll_event events[256];
+        char buf[16384];
+        while (!stop_) {
+            const int n = epoll_wait(ep, events, 256, 100);
+            for (int i = 0; i < n; ++i) {
+                const int tag = events[i].data.fd;
+                if (tag < 0) {
+                    const int lfd = -tag - 1;
+                    int c;
+                    while ((c = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+                        const int one = 1;
+                        setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // fails harmlessly on AF_UNIX
+                        epoll_event ev{};
+                        ev.events = EPOLLIN;
+                        ev.data.fd = c;
+                        epoll_ctl(ep, EPOLL_CTL_ADD, c, &ev);
+                    }
+                    continue;
+                }
+                auto& in = pending[tag];
+                ssize_t r;
+                while ((r = read(tag, buf, sizeof(buf))) > 0) in.append(buf, static_cast<size_t>(r));
+                if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    pending.erase(tag);
+                    close(tag);
+                    continue;
+                }
+                // Requests carry no body, so each header terminator is one request
+                size_t pos, replies = 0;
+                while ((pos = in.find("\r\n\r\n")) != std::string::npos) {
+                    in.erase(0, pos + 4);
+                    ++replies;
+                }
+                for (size_t k = 0; k < replies; ++k) {
+                    if (write(tag, kReply, sizeof(kReply) - 1) < 0) break;
+                }
+            }
+        }
+        for (auto& kv : pending) close(kv.first);
+    }
+
+    std::vector<int> listeners_;  // TCP first, then the Unix one if any
+    size_t tcp_listeners_ = 0;
+    std::vector<int> epolls_;
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stop_{false};
+};
+
+struct Step {
+    double rps;
+    double p50_us;
+    double p99_us;
+    size_t stolen;
+};
+
+Step run_step(const std::vector<std::string>& urls, size_t loops, size_t requests, size_t window, bool steal,
+              const std::string& unix_name) {
+    net::AsyncHttpClient::Options opt;
+    // The URLs stay the same, so requests shard across loops exactly as over TCP
+    opt.http.unix_socket_path = unix_name;
+    opt.http.abstract_unix_socket = !unix_name.empty();
+    opt.event_loops = loops;
+    opt.max_in_flight = std::max<size_t>(1, window / loops);
+    opt.work_stealing = steal;
+    for (size_t i = 0; i < loops; ++i) opt.cpu_affinity.push_back(static_cast<int>(i));
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::vector<double> latencies;
+    latencies.reserve(requests);
+    std::atomic<size_t> issued{0};
+    size_t completed = 0;
+    // Reset explicitly below so the loops are joined before the state they use goes away
+    std::unique_ptr<net::AsyncHttpClient> client;
+
+    // Each completion issues the next request, keeping `window` outstanding
+    std::function<void()> issue = [&] {
+        const size_t i = issued.fetch_add(1);
+        if (i >= requests) return;
+        net::AsyncRequest req;
+        req.url = urls[i % urls.size()];
+        const auto t0 = Clock::now();
+        client->submit(std::move(req), [&, t0](net::AsyncResult r) {
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+            {
+                std::lock_guard<std::mutex> lk(mu);
+                if (!r.error) latencies.push_back(us);
+                if (++completed == requests) cv.notify_one();
+            }
+            issue();
+        });
+    };
+
+    client = std::make_unique<net::AsyncHttpClient>(opt);
+    const auto start = Clock::now();
+    for (size_t i = 0; i < std::min(window, requests); ++i) issue();
+    {
+        std::unique_lock<std::mutex> lk(mu);
+        cv.wait(lk, [&]{ return completed == requests; });
+    }
+    const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    const size_t stolen = client->stolen();
+    client.reset();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        if (latencies.empty()) return 0.0;
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    return {latencies.size() / secs, pct(0.50), pct(0.99), stolen};
+}
+
+size_t arg_value(int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        std::cerr << "missing value for " << argv[i] << "\n";
+        std::exit(2);
+    }
+    return static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_loops = std::min<size_t>(32, std::max(1u, std::thread::hardware_concurrency()));
+    size_t requests = 200000;
+    size_t window = 512;
+    size_t ports = 16;
+    size_t server_threads = 0;
+    bool steal = true;
+    bool unix_too = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--max-loops") max_loops = arg_value(i, argc, argv);
+        else if (a == "--requests") requests = arg_value(i, argc, argv);
+        else if (a == "--window") window = arg_value(i, argc, argv);
+        else if (a == "--ports") ports = arg_value(i, argc, argv);
+        else if (a == "--server-threads") server_threads = arg_value(i, argc, argv);
+        else if (a == "--no-steal") steal = false;
+        else if (a == "--unix") unix_too = true;
+        else {
+            std::cerr << "unknown argument " << a << "\n";
+            return 2;
+        }
+    }
+    if (server_threads == 0) server_threads = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+
+    const std::string unix_name = unix_too ? "api_wrapper_bench_" + std::to_string(getpid()) : "";
+    LoopbackServer server(std::max<size_t>(1, ports), server_threads, unix_name);
+    std::vector<std::string> urls;
+    for (int port : server.ports()) urls.push_back("http://127.0.0.1:" + std::to_string(port) + "/");
+
+    std::printf("%6s %9s %12s %10s %10s %10s\n", "loops", "transport", "req/s", "p50_us", "p99_us", "stolen");
+    for (size_t loops = 1; loops <= max_loops; loops *= 2) {
+        const Step s = run_step(urls, loops, requests, window, steal, "");
+        std::printf("%6zu %9s %12.0f %10.0f %10.0f %10zu\n", loops, "tcp", s.rps, s.p50_us, s.p99_us, s.stolen);
+        if (!unix_too) continue;
+        const Step u = run_step(urls, loops, requests, window, steal, unix_name);
+        std::printf("%6zu %9s %12.0f %10.0f %10.0f %10zu\n", loops, "unix", u.rps, u.p50_us, u.p99_us, u.stolen);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "http_client.hpp"
+#include "request_options.hpp"
+#include "request_scheduler.hpp"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace net {
+
+struct AsyncRequest {
+    std::string method;   // "GET" or "POST"
+    std::string url;
+    HeaderList headers;
+    std::string body;     // POST payload
+    RequestOptions ro;    // deadline, cancellation, priority
+    AsyncRequest() : method("GET") {}
+};
+
+// Outcome of an async request: either a response or the exception a blocking
+// call would have thrown
+struct AsyncResult {
+    Response response;
+    std::exception_ptr error;
+};
+
+// Non-blocking client: event-loop threads each drive their own curl multi
+// handle (and so their own connection cache), and many requests run
+// concurrently on each. Requests are sharded across loops by host so
+// connections to one upstream are reused; a loop with spare capacity steals
+// queued (not yet started) requests from busier ones. Within a loop, requests
+// wait in a weighted fair queue per Priority and are started while fewer than
+// max_in_flight are running, so interactive calls are not stuck behind bulk
+// transfers. Thread-safe: submit from any thread.
+//
+// Only the transfer settings of Options::http are used (timeouts, redirects,
+// user-agent, TLS); the policy members (retry, cache, limiters, ...) apply to
+// the blocking HttpClient.
+class AsyncHttpClient {
+public:
+    struct Options {
+        HttpClient::Options http;
+        size_t event_loops;     // threads, each with its own multi handle
+        size_t max_in_flight;   // per event loop
+        bool work_stealing;
+        // Loop i is pinned to cpu_affinity[i % size()]; empty leaves placement
+        // to the OS. Ignored on platforms without thread affinity.
+        std::vector<int> cpu_affinity;
+        SchedulerOptions scheduler;
+        Options() : event_loops(1), max_in_flight(64), work_stealing(true) {}
+    };
+
+    using Completion = std::function<void(AsyncResult)>;
+
+    AsyncHttpClient();
+    explicit AsyncHttpClient(Options opt);
+    // Fails everything still queued or in flight with HttpError and joins the loops
+    ~AsyncHttpClient();
+
+    AsyncHttpClient(const AsyncHttpClient&) = delete;
+    AsyncHttpClient& operator=(const AsyncHttpClient&) = delete;
+
+    // done runs on an event-loop thread and must not block
+    void submit(AsyncRequest req, Completion done);
+
+    std::future<Response> get(const std::string& url, const HeaderList& headers = {},
+                              const RequestOptions& ro = {});
+    std::future<Response> post(const std::string& url, std::string data, const HeaderList& headers = {},
+                               const RequestOptions& ro = {});
+
+    size_t queued() const;
+    size_t in_flight() const;
+    // Requests one loop took from another's queue since construction
+    size_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+
+private:
+    struct Job;
+    struct Loop;
+    using JobPtr = std::unique_ptr<Job>;
+
+    // Shared with cancellation callbacks, which can outlive the client
+    struct Wake {
+        std::mutex mu;
+        CURLM* multi = nullptr;
+        int event_fd = -1;  // Linux only
+        std::atomic<size_t> cancels{0};
+    };
+
+    void run(Loop& loop);
+    void sweep_queue(Loop& loop);
+    void start_ready(Loop& loop);
+    size_t steal(Loop& thief);
+    bool start(Loop& loop, JobPtr job);
+    void reap(Loop& loop);
+    void abort_cancelled(Loop& loop);
+    void finish(Loop& loop, CURL* h, CURLcode res);
+    void fail(JobPtr job, std::exception_ptr error);
+    void shutdown(Loop& loop);
+    void wake_idle_peer(const Loop& busy);
+    void drain_inbox(Loop& loop);
+    static void notify(Loop& loop);
+    static void signal(Wake& w);
+
+    Options opt_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> stolen_{0};
+};
+
+} // namespace net
@@ -0,0 +1,37 @@
+#pragma once
+#include "request_options.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace net {
+
+// Process-wide download budget shared by every HttpClient given it, so bulk
+// transfers cannot fill the link and queue up interactive responses behind
+// them. A byte-rate GCRA: the state is one atomic timestamp and each charge
+// is a single CAS.
+//
+// Interactive requests are charged but never wait, so their bytes come out
+// of what Batch and Background traffic may use; those slow down (the
+// transfer's write callback sleeps) until the budget has room again.
+class BandwidthBudget {
+public:
+    struct Options {
+        double bytes_per_sec; // 0 = unlimited (charges are free)
+        double burst_bytes;   // may be received at full speed before pacing starts
+        Options() : bytes_per_sec(0), burst_bytes(256 * 1024) {}
+    };
+
+    explicit BandwidthBudget(Options opt);
+
+    // Records bytes just received; returns how long the transfer should pause
+    std::chrono::nanoseconds charge(size_t bytes, Priority priority);
+
+private:
+    double ns_per_byte_;           // 0 = unlimited
+    int64_t tolerance_ns_;
+    std::atomic<int64_t> tat_{0};  // steady_clock ns
+};
+
+} // namespace net
@@ -0,0 +1,82 @@
+#pragma once
+#include "response.hpp"
+#include <curl/curl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace net {
+
+// Handle on a streaming transfer that its sink paused. Copies share state,
+// so a sink can keep one and call resume() later from any thread (e.g. once
+// a downstream writer has drained).
+class StreamControl {
+public:
+    StreamControl() : state_(std::make_shared<State>()) {}
+
+    // Restarts the transfer; the refused chunk is offered to the sink again
+    void resume() const {
+        std::lock_guard<std::mutex> lk(state_->mu);
+        state_->resume = true;
+        if (state_->multi) curl_multi_wakeup(state_->multi);
+    }
+
+    // Call from inside the sink: ends the transfer after this chunk (whether
+    // the sink then returns true or false), and stream() returns normally
+    // with the status and headers it got
+    void stop() const {
+        std::lock_guard<std::mutex> lk(state_->mu);
+        state_->stop = true;
+    }
+
+    // Call from inside the sink: the status and headers of the response
+    // whose body is being streamed (e.g. to check its Content-Type before
+    // consuming the first chunk)
+    long status() const { return state_->status; }
+    const HeaderList& headers() const {
+        static const HeaderList none;
+        return state_->headers ? *state_->headers : none;
+    }
+
+private:
+    friend class HttpClient;
+
+    struct State {
+        std::mutex mu;
+        bool resume = false;
+        bool stop = false;
+        CURLM* multi = nullptr;  // driving the transfer, while it runs
+        // Set before each sink call, on the thread driving the transfer
+        long status = 0;
+        const HeaderList* headers = nullptr;
+    };
+
+    void attach(CURLM* multi) const {
+        std::lock_guard<std::mutex> lk(state_->mu);
+        state_->multi = multi;
+    }
+    bool take_resume() const {
+        std::lock_guard<std::mutex> lk(state_->mu);
+        const bool r = state_->resume;
+        state_->resume = false;
+        return r;
+    }
+
+    bool stopped() const {
+        std::lock_guard<std::mutex> lk(state_->mu);
+        return state_->stop;
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+// Receives a 2xx response body chunk by chunk. Returning false means "not
+// ready": the transfer is paused (curl stops reading the socket, so TCP flow
+// control slows the sender) until control.resume(), and the same chunk is
+// then offered again. Memory stays bounded by what curl has already read.
+// An exception thrown by the sink ends the transfer and is rethrown by
+// stream().
+using BodySink = std::function<bool(std::string_view chunk, const StreamControl& control)>;
+
+} // namespace net
@@ -0,0 +1,52 @@
+#pragma once
+#include "http_client.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace net {
+
+// Background worker that revalidates cache entries served under
+// stale-while-revalidate. It owns its own HttpClient built from the given
+// options, so the cache (and coalescer) in those options are the ones updated.
+// Set the same instance as Options::refresher on the clients that serve stale.
+class CacheRefresher {
+public:
+    explicit CacheRefresher(HttpClient::Options opt, size_t max_queue = 1024);
+    ~CacheRefresher();
+
+    CacheRefresher(const CacheRefresher&) = delete;
+    CacheRefresher& operator=(const CacheRefresher&) = delete;
+
+    // Queues a refresh; a variant (url plus the values of the request headers
+    // named in vary) already queued or in flight is not queued twice.
+    // Returns false if the queue is full or the refresher is stopping, in
+    // which case the caller should refresh synchronously.
+    bool schedule(const std::string& url, const HeaderList& headers, const HeaderList& vary = {});
+
+    size_t pending() const;
+
+private:
+    struct Job {
+        std::string key;
+        std::string url;
+        HeaderList headers;
+    };
+
+    void run();
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    std::unordered_set<std::string> queued_;  // keys queued or in flight
+    size_t max_queue_;
+    bool stop_ = false;
+    CancellationSource in_flight_;  // cancelled on destruction
+    HttpClient client_;
+    std::thread worker_;
+};
+
+} // namespace net
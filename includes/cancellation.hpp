@@ -0,0 +1,134 @@
+#pragma once
+#include "response.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace net {
+
+// Thrown when a request is cancelled through its CancellationToken
+class CancelledError : public HttpError {
+public:
+    explicit CancelledError(const std::string& what) : HttpError(what) {}
+};
+
+namespace detail {
+
+struct CancelState {
+    std::mutex mu;
+    std::condition_variable cv;
+    std::atomic<bool> cancelled{false};  // written under mu, read lock-free
+    uint64_t next_id = 1;
+    std::vector<std::pair<uint64_t, std::function<void()>>> callbacks;
+    uint64_t running = 0;        // callback cancel() is executing right now
+    std::thread::id runner;      // ...and the thread executing it
+};
+
+} // namespace detail
+
+// Observer side of a cancellation. A default-constructed token is never cancelled.
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool valid() const { return state_ != nullptr; }
+    bool cancelled() const { return state_ && state_->cancelled.load(std::memory_order_acquire); }
+
+    // Sleeps for d unless cancelled first; returns true if cancelled
+    template <typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> d) const {
+        if (!state_) {
+            std::this_thread::sleep_for(d);
+            return false;
+        }
+        std::unique_lock<std::mutex> lk(state_->mu);
+        return state_->cv.wait_for(lk, d, [this]{ return state_->cancelled.load(); });
+    }
+
+    // Runs cb on cancel() (on the cancelling thread), or immediately if already
+    // cancelled. Returns an id for remove_callback(); 0 if cb already ran.
+    uint64_t add_callback(std::function<void()> cb) const {
+        if (!state_) return 0;
+        {
+            std::lock_guard<std::mutex> lk(state_->mu);
+            if (!state_->cancelled) {
+                const auto id = state_->next_id++;
+                state_->callbacks.emplace_back(id, std::move(cb));
+                return id;
+            }
+        }
+        cb();
+        return 0;
+    }
+
+    // After this returns the callback is not running and never will, so it
+    // may reference objects that are about to be destroyed. Waits for a
+    // concurrent cancel() that is executing it, unless called from inside it.
+    void remove_callback(uint64_t id) const {
+        if (!state_ || id == 0) return;
+        std::unique_lock<std::mutex> lk(state_->mu);
+        auto& cbs = state_->callbacks;
+        for (auto it = cbs.begin(); it != cbs.end(); ++it) {
+            if (it->first == id) { cbs.erase(it); return; }
+        }
+        if (state_->running == id && state_->runner != std::this_thread::get_id())
+            state_->cv.wait(lk, [&]{ return state_->running != id; });
+    }
+
+private:
+    friend class CancellationSource;
+    explicit CancellationToken(std::shared_ptr<detail::CancelState> s) : state_(std::move(s)) {}
+    std::shared_ptr<detail::CancelState> state_;
+};
+
+// Owner side: hand token() to requests, call cancel() when the work is no
+// longer wanted (e.g. the inbound client disconnected).
+class CancellationSource {
+public:
+    CancellationSource() : state_(std::make_shared<detail::CancelState>()) {}
+
+    CancellationToken token() const { return CancellationToken(state_); }
+
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lk(state_->mu);
+            if (state_->cancelled) return;
+            state_->cancelled.store(true, std::memory_order_release);
+        }
+        state_->cv.notify_all();
+        // Callbacks are taken one at a time, so one that is removed before
+        // its turn never runs, and one that is running is waited for
+        for (;;) {
+            std::function<void()> cb;
+            {
+                std::lock_guard<std::mutex> lk(state_->mu);
+                auto& cbs = state_->callbacks;
+                if (cbs.empty()) break;
+                state_->running = cbs.front().first;
+                state_->runner = std::this_thread::get_id();
+                cb = std::move(cbs.front().second);
+                cbs.erase(cbs.begin());
+            }
+            cb();
+            {
+                std::lock_guard<std::mutex> lk(state_->mu);
+                state_->running = 0;
+            }
+            state_->cv.notify_all();
+        }
+    }
+
+    bool cancelled() const { return token().cancelled(); }
+
+private:
+    std::shared_ptr<detail::CancelState> state_;
+};
+
+} // namespace net
@@ -0,0 +1,90 @@
+#pragma once
+#include "response.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace net {
+
+// Thrown instead of attempting a transfer while a host's circuit is open
+class CircuitOpenError : public HttpError {
+public:
+    explicit CircuitOpenError(const std::string& what) : HttpError(what) {}
+};
+
+// Per-host circuit breakers. A breaker trips (Closed -> Open) when, over a
+// sliding window, the error rate or the slow-call rate crosses its threshold.
+// While Open every call fails fast; after open_ms a few half-open probes are
+// let through, and the circuit closes only if they all succeed.
+// Share one instance across the clients that call the same hosts.
+class CircuitBreaker {
+public:
+    enum class State { Closed, Open, HalfOpen };
+
+    struct Options {
+        double failure_rate_threshold;  // fraction of calls in the window
+        double slow_rate_threshold;
+        long slow_call_ms;              // 0 = latency is not considered
+        size_t min_calls;               // no decision below this many calls
+        long window_ms;
+        long open_ms;                   // time before half-open probes
+        int half_open_probes;
+        Options()
+            : failure_rate_threshold(0.5),
+              slow_rate_threshold(0.8),
+              slow_call_ms(0),
+              min_calls(20),
+              window_ms(10000),
+              open_ms(5000),
+              half_open_probes(1) {}
+    };
+
+    class Host;
+
+    // Admission for one call. Report the outcome once; a ticket destroyed
+    // without a report (e.g. the call never started) records nothing.
+    class Ticket {
+    public:
+        Ticket(Ticket&& other) noexcept : host_(other.host_), round_(other.round_) { other.host_ = nullptr; }
+        Ticket& operator=(Ticket&& other) noexcept {
+            if (this != &other) { abandon(); host_ = other.host_; round_ = other.round_; other.host_ = nullptr; }
+            return *this;
+        }
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+        ~Ticket() { abandon(); }
+
+        void record(bool success, long latency_ms);
+        void abandon();
+
+    private:
+        friend class CircuitBreaker;
+        Ticket(Host* h, uint64_t round) : host_(h), round_(round) {}
+        Host* host_;
+        uint64_t round_;  // half-open round this probe belongs to; 0 = not a probe
+    };
+
+    CircuitBreaker();
+    explicit CircuitBreaker(Options opt);
+    ~CircuitBreaker();
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    // nullopt = circuit open, fail fast
+    std::optional<Ticket> admit(const std::string& host);
+    State state(const std::string& host);
+
+private:
+    Host& host_for(const std::string& host);
+
+    Options opt_;
+    std::mutex mu_;
+    std::unordered_map<std::string, std::unique_ptr<Host>> hosts_;
+};
+
+} // namespace net
@@ -0,0 +1,99 @@
+#pragma once
+#include "cancellation.hpp"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace net {
+
+// Adaptive in-flight limits per upstream, driven by the round-trip times the
+// client measures itself. AIMD grows the limit by ~1 per window of successes
+// and cuts it multiplicatively on drops; Gradient compares short- and
+// long-term RTT and shrinks the limit as queueing delay builds up. Requests
+// over the limit wait up to max_queue_wait_ms and are then rejected.
+// Share one instance across the clients (threads) that call the same upstreams.
+class ConcurrencyLimiter {
+public:
+    enum class Algorithm { Aimd, Gradient };
+
+    struct Options {
+        Algorithm algorithm;
+        double initial_limit;
+        double min_limit;
+        double max_limit;
+        double backoff_ratio;       // multiplicative decrease on a drop
+        long latency_threshold_ms;  // AIMD: slower samples count as drops (0 = off)
+        double rtt_tolerance;       // Gradient: accepted long/short RTT inflation
+        double smoothing;           // Gradient: weight of each new estimate
+        long max_queue_wait_ms;     // 0 = reject immediately when at the limit
+        size_t max_queued;
+        Options()
+            : algorithm(Algorithm::Gradient),
+              initial_limit(20),
+              min_limit(1),
+              max_limit(500),
+              backoff_ratio(0.9),
+              latency_threshold_ms(0),
+              rtt_tolerance(1.5),
+              smoothing(0.2),
+              max_queue_wait_ms(50),
+              max_queued(1000) {}
+    };
+
+    class Limit;
+
+    // An acquired in-flight slot. Report the outcome once; a permit destroyed
+    // without a report releases its slot without a sample.
+    class Permit {
+    public:
+        Permit(Permit&& other) noexcept : limit_(other.limit_) { other.limit_ = nullptr; }
+        Permit& operator=(Permit&& other) noexcept {
+            if (this != &other) { ignore(); limit_ = other.limit_; other.limit_ = nullptr; }
+            return *this;
+        }
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+        ~Permit() { ignore(); }
+
+        void success(long rtt_us);
+        void dropped();  // timeout, connection failure, overload status
+        void ignore();
+
+    private:
+        friend class ConcurrencyLimiter;
+        explicit Permit(Limit* l) : limit_(l) {}
+        Limit* limit_;
+    };
+
+    ConcurrencyLimiter();
+    explicit ConcurrencyLimiter(Options opt);
+    ~ConcurrencyLimiter();
+
+    ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+    // Waits (up to max_queue_wait_ms) for a slot; nullopt if rejected
+    std::optional<Permit> acquire(const std::string& upstream);
+    // Waits up to the smaller of max_wait_ms and max_queue_wait_ms, and
+    // gives up early once cancel fires
+    std::optional<Permit> acquire(const std::string& upstream, long max_wait_ms, const CancellationToken& cancel);
+    // Non-blocking variant, used for optional work such as hedges
+    std::optional<Permit> try_acquire(const std::string& upstream);
+
+    long max_queue_wait_ms() const { return opt_.max_queue_wait_ms; }
+
+    double limit(const std::string& upstream);
+    int in_flight(const std::string& upstream);
+
+private:
+    Limit& limit_for(const std::string& upstream);
+
+    Options opt_;
+    std::mutex mu_;
+    std::unordered_map<std::string, std::unique_ptr<Limit>> limits_;
+};
+
+} // namespace net
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace net {
+
+// Persistent key -> (metadata, body) store backed by one append-only file.
+// Reads come straight out of a read-only memory mapping of that file, so a hit
+// hands out views without copying. Records are length-prefixed and
+// checksummed; a torn tail from a crash is truncated away on open. The index
+// is rebuilt on open by skipping from record header to record header, so
+// bodies are never read during startup. Thread-safe.
+class DiskCache {
+public:
+    struct Options {
+        std::string path;
+        uint64_t max_bytes;   // file size that triggers compaction
+        Options() : max_bytes(uint64_t(1) << 30) {}
+    };
+
+    // Views stay valid for as long as the Hit (its mapping) is alive
+    struct Hit {
+        std::string_view meta;
+        std::string_view body;
+        std::shared_ptr<const void> mapping;
+    };
+
+    explicit DiskCache(Options opt);
+    ~DiskCache();
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    std::optional<Hit> lookup(const std::string& key);
+    void put(const std::string& key, std::string_view meta, std::string_view body);
+    // Replaces the metadata but keeps the stored body (e.g. after a 304);
+    // false if the key is (now) absent
+    bool update_meta(const std::string& key, std::string_view meta);
+    void erase(const std::string& key);
+
+    uint64_t file_bytes() const;
+    size_t entries() const;
+
+private:
+    struct Location {
+        uint64_t meta_off = 0;
+        uint32_t meta_len = 0;
+        uint64_t body_off = 0;
+        uint64_t body_len = 0;
+        uint64_t record_bytes = 0;  // bytes this key keeps live (for compaction)
+    };
+    class Mapping;
+
+    void open_locked();
+    void load_index_locked();
+    void append_locked(const std::string& key, std::string_view meta, std::string_view body, uint32_t flags,
+                       const Location* reuse_body);
+    void drop_locked(const std::string& key);  // index only
+    void compact_locked();
+    std::shared_ptr<const Mapping> mapping_for_locked(uint64_t end);
+
+    Options opt_;
+    mutable std::mutex mu_;
+    std::FILE* file_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t live_bytes_ = 0;
+    bool compact_failed_ = false;
+    std::unordered_map<std::string, Location> index_;
+    std::shared_ptr<const Mapping> mapping_;
+};
+
+} // namespace net
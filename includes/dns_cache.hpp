@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace net {
+
+// Process-wide resolver cache that keeps the system resolver off the request
+// path. Lookups only read the cache; a miss returns nothing (curl then
+// resolves as usual) and queues the host for a background thread. Entries
+// that are in use get re-resolved shortly before they expire, so a hot host
+// never goes cold. Results are handed to curl as CURLOPT_RESOLVE pins.
+//
+// getaddrinfo() does not report record TTLs, so ttl_ms is a fixed policy
+// rather than the DNS TTL. If a refresh fails the last good addresses are
+// kept for stale_ms more. Thread-safe; share one instance between clients.
+class DnsCache {
+public:
+    struct Options {
+        long ttl_ms;           // how long resolved addresses are used
+        double refresh_ahead;  // re-resolve used entries at this fraction of ttl
+        long stale_ms;         // serve last good addresses this long after a failed refresh
+        long idle_evict_ms;    // drop entries nobody looked up for this long
+        size_t max_hosts;
+        Options()
+            : ttl_ms(30000), refresh_ahead(0.75), stale_ms(300000), idle_evict_ms(600000), max_hosts(4096) {}
+    };
+
+    // "host:port:addr1,addr2" for CURLOPT_RESOLVE; generation changes
+    // whenever the address list does
+    struct Pin {
+        std::string resolve;
+        uint64_t generation = 0;
+    };
+
+    DnsCache();
+    explicit DnsCache(Options opt);
+    ~DnsCache();
+
+    DnsCache(const DnsCache&) = delete;
+    DnsCache& operator=(const DnsCache&) = delete;
+
+    // Never blocks on DNS. IP literals are never cached.
+    std::optional<Pin> lookup(const std::string& host, int port);
+
+    // Resolves host in the background (e.g. at startup, for known upstreams)
+    void prefetch(const std::string& host, int port);
+
+    size_t size() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string host;
+        int port = 0;
+        Pin pin;
+        Clock::time_point resolved_at{};   // last successful resolve
+        Clock::time_point next_refresh{};
+        Clock::time_point serve_until{};
+        std::atomic<int64_t> last_used{0};  // Clock ticks; written under the shared lock
+        std::atomic<bool> used{false};      // looked up since the last refresh
+    };
+
+    static std::string key_of(const std::string& host, int port);
+    void schedule(const std::string& host, int port);
+    void run();
+
+    Options opt_;
+    mutable std::shared_mutex mu_;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries_;
+    uint64_t next_generation_ = 0;  // unique across entries, so a re-created entry re-pins
+
+    std::mutex queue_mu_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, std::pair<std::string, int>> pending_;
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+} // namespace net
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace net {
+
+// Fixed-size ring of recent request latencies; thread-safe so one tracker can
+// be shared by several clients talking to the same backend.
+class LatencyTracker {
+public:
+    explicit LatencyTracker(size_t capacity = 512);
+
+    void record(long latency_ms);
+    size_t samples() const;
+    // Returns the latency at percentile p in [0, 1], or -1 if no samples exist
+    long percentile(double p) const;
+
+private:
+    mutable std::mutex mu_;
+    std::vector<long> ring_;
+    size_t next_ = 0;
+    size_t count_ = 0;
+};
+
+struct HedgePolicy {
+    bool enabled;
+    double percentile;        // hedge once the first attempt exceeds this latency percentile
+    size_t min_samples;       // below this many samples, fixed_delay_ms is used
+    long fixed_delay_ms;
+    long min_delay_ms;        // floor so a fast backend does not get every request doubled
+    bool fresh_connection;    // send the hedge over a new connection, not behind the slow one
+    std::shared_ptr<LatencyTracker> latency;  // optional; the client keeps its own if unset
+
+    HedgePolicy()
+        : enabled(false),
+          percentile(0.95),
+          min_samples(20),
+          fixed_delay_ms(50),
+          min_delay_ms(5),
+          fresh_connection(true) {}
+
+    long delay_ms(const LatencyTracker& tracker) const;
+};
+
+} // namespace net
@@ -1,89 +1,261 @@
-#pragma once
-#include <curl/curl.h>
-#include <string>
-#include <vector>
-#include <utility>
-#include <optional>
-#include <stdexcept>
-#include <mutex>
-
-namespace net {
-
-struct Response {
-    long status = 0;
-    std::string body;
-    std::vector<std::pair<std::string, std::string>> headers;
-};
-
-class HttpError : public std::runtime_error {
-public:
-    explicit HttpError(const std::string& what) : std::runtime_error(what) {}
-};
-
-class HttpClient {
-public:
-    struct Options {
-        long timeout_ms;
-        bool follow_redirects;
-        std::optional<std::string> user_agent;
-        bool verify_peer;   // TLS peer verification
-        bool verify_host;   // TLS host verification
-        Options()
-            : timeout_ms(15000),
-              follow_redirects(true),
-              user_agent(std::string("HttpClient/1.0")),
-              verify_peer(true),
-              verify_host(true) {}
-    };
-
-    HttpClient();
-    explicit HttpClient(Options opt);
-    ~HttpClient();
-
-    // Non-copyable, moveable (resource-owning class)
-    HttpClient(const HttpClient&) = delete;
-    HttpClient& operator=(const HttpClient&) = delete;
-    HttpClient(HttpClient&&) noexcept;
-    HttpClient& operator=(HttpClient&&) noexcept;
-
-    // High-level methods
-    Response get(const std::string& url,
-                 const std::vector<std::pair<std::string,std::string>>& headers = {});
-
-    Response post(const std::string& url,
-                  std::string_view data,
-                  const std::vector<std::pair<std::string,std::string>>& headers = {});
-
-    // Allows changing options at runtime
-    void set_options(const Options& opt);
-
-private:
-    // RAII wrapper for curl_slist*
-    struct Slist {
-        curl_slist* ptr = nullptr;
-        ~Slist() { if (ptr) curl_slist_free_all(ptr); }
-        Slist(const Slist&) = delete;
-        Slist& operator=(const Slist&) = delete;
-        Slist() = default;
-        Slist(Slist&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
-        Slist& operator=(Slist&& other) noexcept { if (this != &other) { if (ptr) curl_slist_free_all(ptr); ptr = other.ptr; other.ptr = nullptr; } return *this; }
-        void add(const std::string& h) { ptr = curl_slist_append(ptr, h.c_str()); }
-    };
-
-    // Thread-safe global initialization of libcurl
-    static void global_init_once();
-
-    static size_t write_body_cb(char* ptr, size_t size, size_t nmemb, void* userdata);
-    static size_t write_header_cb(char* buffer, size_t size, size_t nitems, void* userdata);
-
-    void apply_common_options();
-    Response perform_with_headers_and_body();
-
-private:
-    CURL* h_ = nullptr;
-    Options opt_;
-    std::string body_acc_;
-    std::vector<std::pair<std::string, std::string>> hdr_acc_;
-};
-
-} // namespace net
+#pragma once
+#include <curl/curl.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <stdexcept>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+#include "response.hpp"
+#include "retry.hpp"
+#include "hedging.hpp"
+#include "singleflight.hpp"
+#include "response_cache.hpp"
+#include "rate_limiter.hpp"
+#include "concurrency_limiter.hpp"
+#include "circuit_breaker.hpp"
+#include "tls_session_store.hpp"
+#include "dns_cache.hpp"
+#include "load_balancer.hpp"
+#include "bandwidth_budget.hpp"
+#include "body_stream.hpp"
+#include "line_splitter.hpp"
+#include "url.hpp"
+#include "request_options.hpp"
+
+namespace net {
+
+class CacheRefresher;
+
+class HttpClient {
+public:
+    struct Options {
+        long timeout_ms;               // whole transfer (CURLOPT_TIMEOUT_MS)
+        long connect_timeout_ms;       // TCP + TLS setup; 0 = libcurl default
+        long first_byte_timeout_ms;    // attempt start -> first response header; 0 = off
+        long low_speed_limit_bps;      // abort if slower than this...
+        long low_speed_time_s;         // ...for this long; 0 = off
+        long max_recv_bps;             // per-transfer download cap in bytes/s; 0 = unlimited
+        long max_send_bps;             // per-transfer upload cap; 0 = unlimited
+        bool follow_redirects;
+        std::optional<std::string> user_agent;
+        bool verify_peer;   // TLS peer verification
+        bool verify_host;   // TLS host verification
+        std::string unix_socket_path;  // connect here instead of the URL's host:port; "" = TCP
+        bool abstract_unix_socket;     // unix_socket_path is a Linux abstract-namespace name
+        // Connection pool. The first two apply per multi handle, i.e. per
+        // AsyncHttpClient loop or ReactorHttpClient; transfers over a limit
+        // wait inside curl (their timeout keeps running)
+        long max_connections;          // open connections; 0 = unlimited
+        long max_host_connections;     // open connections per host:port; 0 = unlimited
+        long max_idle_connections;     // size of the idle-connection cache; 0 = libcurl default
+        long max_idle_s;               // don't reuse a connection idle longer; 0 = libcurl default (118 s)
+        long max_connection_age_s;     // don't reuse a connection older than this; 0 = off (libcurl 7.80+)
+        bool reuse_connections;        // false = a fresh connection per request
+        bool tcp_nodelay;
+        bool tcp_keepalive;            // keepalive probes, so NATs don't silently drop idle sockets
+        long tcp_keepidle_s;           // idle time before the first probe
+        long tcp_keepintvl_s;          // time between probes
+        RetryPolicy retry;  // default: single attempt
+        HedgePolicy hedge;  // GET only; default: disabled
+        std::shared_ptr<RequestCoalescer> coalescer;  // GET only; shared across clients
+        std::shared_ptr<ResponseCache> cache;         // GET only; shared across clients
+        std::shared_ptr<CacheRefresher> refresher;    // enables stale-while-revalidate
+        std::shared_ptr<HostRateLimiter> rate_limiter; // consulted before every transfer
+        std::shared_ptr<ConcurrencyLimiter> concurrency_limiter;  // adaptive in-flight limit per host:port
+        std::shared_ptr<CircuitBreaker> circuit_breaker;          // fail fast on dead hosts
+        std::shared_ptr<TlsSessionStore> tls_sessions;            // TLS resumption across restarts
+        std::shared_ptr<DnsCache> dns;                            // pins resolved addresses via CURLOPT_RESOLVE
+        std::shared_ptr<LoadBalancer> load_balancer;              // spreads requests across a host's addresses
+        std::shared_ptr<BandwidthBudget> download_budget;         // process-wide; paces non-interactive GETs/POSTs
+        Options()
+            : timeout_ms(15000),
+              connect_timeout_ms(0),
+              first_byte_timeout_ms(0),
+              low_speed_limit_bps(0),
+              low_speed_time_s(0),
+              max_recv_bps(0),
+              max_send_bps(0),
+              follow_redirects(true),
+              user_agent(std::string("HttpClient/1.0")),
+              verify_peer(true),
+              verify_host(true),
+              abstract_unix_socket(false),
+              max_connections(0),
+              max_host_connections(0),
+              max_idle_connections(0),
+              max_idle_s(0),
+              max_connection_age_s(0),
+              reuse_connections(true),
+              tcp_nodelay(true),
+              tcp_keepalive(false),
+              tcp_keepidle_s(60),
+              tcp_keepintvl_s(60) {}
+    };
+
+    HttpClient();
+    explicit HttpClient(Options opt);
+    ~HttpClient();
+
+    // Non-copyable, moveable (resource-owning class)
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+    HttpClient(HttpClient&&) noexcept;
+    HttpClient& operator=(HttpClient&&) noexcept;
+
+    // High-level methods
+    Response get(const std::string& url,
+                 const std::vector<std::pair<std::string,std::string>>& headers = {},
+                 const RequestOptions& ro = {});
+
+    // Same as get() but returns the shared immutable Response, so coalesced
+    // callers and cache hits do not copy the body
+    SharedResponse get_shared(const std::string& url,
+                              const std::vector<std::pair<std::string,std::string>>& headers = {},
+                              const RequestOptions& ro = {});
+
+    // Conditionally refetches url and updates the cache, ignoring freshness
+    // (used by CacheRefresher); without a cache this is get_shared()
+    SharedResponse revalidate(const std::string& url,
+                              const std::vector<std::pair<std::string,std::string>>& headers = {},
+                              const RequestOptions& ro = {});
+
+    Response post(const std::string& url,
+                  std::string_view data,
+                  const std::vector<std::pair<std::string,std::string>>& headers = {},
+                  const RequestOptions& ro = {});
+
+    // GET that hands the body to sink as it arrives instead of buffering it,
+    // with backpressure (see BodySink). Returns status and headers; body is
+    // empty for 2xx and holds the error body otherwise. Never cached,
+    // coalesced or hedged, and retried only before the sink saw any bytes.
+    // timeout_ms covers the whole stream including pauses; long-lived
+    // streams should set it to 0 and rely on deadline / cancel instead.
+    Response stream(const std::string& url,
+                    BodySink sink,
+                    const std::vector<std::pair<std::string,std::string>>& headers = {},
+                    const RequestOptions& ro = {});
+
+    // stream() split into newline-delimited records (NDJSON, JSON Lines) by
+    // a LineSplitter: on_record sees each record as a view that is valid
+    // only during the call, and returns false to stop early
+    Response stream_lines(const std::string& url,
+                          const LineSplitter::Handler& on_record,
+                          const std::vector<std::pair<std::string,std::string>>& headers = {},
+                          const RequestOptions& ro = {},
+                          size_t max_record_bytes = 64u << 20);
+
+    // Opens connections_per_host connections to each host ahead of traffic
+    // (DNS, TCP and TLS), in parallel, and parks them in this client's
+    // connection cache. Hosts are origins ("https://api.example.com:8443") or
+    // bare host names (https assumed). Returns how many connections were
+    // established; unreachable hosts are skipped, malformed ones throw.
+    size_t prewarm(const std::vector<std::string>& hosts, size_t connections_per_host = 1);
+
+    // Allows changing options at runtime
+    void set_options(const Options& opt);
+
+private:
+    // RAII wrapper for curl_slist*
+    struct Slist {
+        curl_slist* ptr = nullptr;
+        ~Slist() { if (ptr) curl_slist_free_all(ptr); }
+        Slist(const Slist&) = delete;
+        Slist& operator=(const Slist&) = delete;
+        Slist() = default;
+        Slist(Slist&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+        Slist& operator=(Slist&& other) noexcept { if (this != &other) { if (ptr) curl_slist_free_all(ptr); ptr = other.ptr; other.ptr = nullptr; } return *this; }
+        void add(const std::string& h) { ptr = curl_slist_append(ptr, h.c_str()); }
+    };
+
+    // Response data accumulated by the callbacks for one transfer
+    struct Transfer {
+        std::string body;
+        std::vector<std::pair<std::string, std::string>> headers;
+        // Progress-callback state
+        std::chrono::steady_clock::time_point started{};
+        long first_byte_timeout_ms = 0;
+        bool got_first_byte = false;
+        CancellationToken cancel;
+        const char* abort_reason = nullptr;  // set when the progress callback aborts
+        BandwidthBudget* budget = nullptr;   // charged for every body byte
+        Priority priority = Priority::Interactive;
+        // Streaming: 2xx body bytes go to sink instead of body
+        long status = 0;                     // of the latest header block
+        const BodySink* sink = nullptr;
+        const StreamControl* control = nullptr;
+        bool streamed = false;               // sink accepted at least one chunk
+        std::exception_ptr sink_error;       // thrown by the sink; rethrown after curl returns
+    };
+
+    // Per-request state threaded through the perform path
+    struct Call {
+        const std::string& url;
+        bool idempotent;
+        const RequestOptions& ro;
+        std::optional<UrlParts> parts;  // parsed on first use
+        std::optional<LoadBalancer::Pick> endpoint;  // address the current attempt was routed to
+        const BodySink* sink = nullptr;              // set by stream()
+        const StreamControl* control = nullptr;      // likewise
+        Call(const std::string& u, bool idem, const RequestOptions& r) : url(u), idempotent(idem), ro(r) {}
+        const UrlParts& target() { if (!parts) parts = split_url(url); return *parts; }
+        std::string upstream() { return target().host + ":" + std::to_string(target().port); }
+    };
+
+    // Thread-safe global initialization of libcurl
+    static void global_init_once();
+
+    static size_t write_body_cb(char* ptr, size_t size, size_t nmemb, void* userdata);
+    static size_t write_header_cb(char* buffer, size_t size, size_t nitems, void* userdata);
+    static int xferinfo_cb(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+    void apply_common_options();
+    Response fetch_get(const std::string& url,
+                       const std::vector<std::pair<std::string,std::string>>& headers,
+                       const RequestOptions& ro);
+    // Conditional fetch against `cached` (may be null) and cache update
+    SharedResponse refresh_entry(const std::string& url,
+                                 const std::vector<std::pair<std::string,std::string>>& headers,
+                                 const SharedCachedResponse& cached,
+                                 const RequestOptions& ro);
+    // fetch_get behind the coalescer, if any
+    SharedResponse fetch_shared(const std::string& url,
+                                const std::vector<std::pair<std::string,std::string>>& headers,
+                                const RequestOptions& ro);
+    // Sets the per-attempt timeouts and progress state on `h` for `t`;
+    // throws HttpError if the deadline has already passed
+    void arm_transfer(CURL* h, Transfer& t, const Call& call);
+    // Runs the transfer, retrying per opt_.retry; throws HttpError if the last attempt fails
+    Response perform_with_headers_and_body(Call& call);
+    // Loads call's host into the share's DNS cache from opt_.dns when the
+    // cached addresses changed since this client last did so, and unloads it
+    // once opt_.dns no longer has the host
+    void pin_dns(Call& call);
+    // Picks an address from opt_.load_balancer and points h at it through
+    // CURLOPT_CONNECT_TO (kept alive in list); clears the option if none
+    void route(CURL* h, std::optional<LoadBalancer::Pick>& pick, Call& call, Slist& list);
+    // One attempt; fills acc_ and status on success
+    CURLcode perform_once(Call& call, long& status);
+    // Drives h_ on multi_. Once delay_ms passes (LONG_MAX = never) a duplicate
+    // is raced against it as a hedge and the loser is cancelled.
+    CURLcode perform_multi(Call& call, long delay_ms, long& status);
+
+private:
+    CURL* h_ = nullptr;
+    CURLM* multi_ = nullptr;  // created on first perform_multi()
+    // Connection, DNS and TLS session caches shared by h_, hedges and
+    // prewarm(), so they all see the same warm connections
+    CURLSH* share_ = nullptr;
+    long max_connects_ = 0;   // raised by prewarm() so the cache keeps what it opened
+    // RESOLVE pins already loaded into share_, by host:port -> DnsCache generation
+    std::unordered_map<std::string, uint64_t> dns_pinned_;
+    Slist resolve_;           // must outlive the transfer it is set on
+    Slist connect_to_;        // likewise
+    Options opt_;
+    Transfer acc_;
+    std::shared_ptr<LatencyTracker> latency_;
+};
+
+} // namespace net
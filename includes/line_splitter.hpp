@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace net {
+
+// Splits a byte stream into newline-delimited records (NDJSON / JSON Lines)
+// as it arrives. A record that lies inside one chunk is handed out as a view
+// into that chunk; only records split across chunks are copied, into a
+// buffer that is reused. Views are valid only during the handler call.
+// "\r\n" endings are trimmed and blank lines skipped.
+class LineSplitter {
+public:
+    // Return false to stop; feed() / finish() then return false too
+    using Handler = std::function<bool(std::string_view record)>;
+
+    // Longer records throw HttpError rather than growing without bound
+    explicit LineSplitter(size_t max_record_bytes = 64u << 20) : max_(max_record_bytes) {}
+
+    bool feed(std::string_view chunk, const Handler& on_record);
+    // Hands out a last record that had no trailing newline
+    bool finish(const Handler& on_record);
+    void reset() { partial_.clear(); }
+
+private:
+    bool emit(std::string_view record, const Handler& on_record);
+
+    std::string partial_;
+    size_t max_;
+};
+
+} // namespace net
@@ -0,0 +1,104 @@
+#pragma once
+#include "dns_cache.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace net {
+
+// Spreads requests for one host:port across all of its addresses instead of
+// letting curl connect to the first one that works. The chosen address is
+// handed to curl as CURLOPT_CONNECT_TO, so the Host header, SNI and
+// certificate checks still use the hostname, and curl's connection cache
+// keeps a separate pool per address.
+//
+// Addresses come from set_endpoints() or, failing that, from the DnsCache
+// (never blocking; until a host is resolved curl picks as usual). An address
+// that fails eject_after times in a row is taken out of rotation for
+// eject_ms, doubling on each repeat up to max_eject_ms, but never more than
+// max_ejected_fraction of a host's addresses at once.
+// Thread-safe; share one instance across the clients that call the same hosts.
+class LoadBalancer {
+public:
+    enum class Policy {
+        RoundRobin,
+        LeastOutstanding,   // fewest requests in flight
+        PowerOfTwoChoices,  // better of two random picks by latency x load
+    };
+
+    struct Options {
+        Policy policy;
+        int eject_after;              // consecutive failures
+        long eject_ms;
+        long max_eject_ms;
+        double max_ejected_fraction;
+        double latency_alpha;         // EWMA weight of each new latency sample
+        Options()
+            : policy(Policy::PowerOfTwoChoices),
+              eject_after(5),
+              eject_ms(30000),
+              max_eject_ms(300000),
+              max_ejected_fraction(0.5),
+              latency_alpha(0.3) {}
+    };
+
+    class Endpoint;
+
+    // One request routed to an address. Report the outcome once; a pick
+    // destroyed without a report (cancelled, lost a hedge race) only stops
+    // counting as outstanding.
+    class Pick {
+    public:
+        Pick(Pick&& other) noexcept : ep_(std::move(other.ep_)) {}
+        Pick& operator=(Pick&& other) noexcept {
+            if (this != &other) { abandon(); ep_ = std::move(other.ep_); }
+            return *this;
+        }
+        Pick(const Pick&) = delete;
+        Pick& operator=(const Pick&) = delete;
+        ~Pick() { abandon(); }
+
+        // "addr" as CURLOPT_CONNECT_TO expects it (IPv6 in brackets)
+        const std::string& address() const;
+        void record(bool success, long latency_us);
+        void abandon();
+
+    private:
+        friend class LoadBalancer;
+        explicit Pick(std::shared_ptr<Endpoint> ep) : ep_(std::move(ep)) {}
+        std::shared_ptr<Endpoint> ep_;
+    };
+
+    // dns defaults to a cache owned by the balancer
+    explicit LoadBalancer(Options opt = Options{}, std::shared_ptr<DnsCache> dns = nullptr);
+    ~LoadBalancer();
+
+    LoadBalancer(const LoadBalancer&) = delete;
+    LoadBalancer& operator=(const LoadBalancer&) = delete;
+
+    // Fixed backends for host:port; DNS is no longer consulted for it
+    void set_endpoints(const std::string& host, int port, const std::vector<std::string>& addresses);
+
+    // nullopt = fewer than two addresses known; let curl connect as usual
+    std::optional<Pick> pick(const std::string& host, int port);
+
+    size_t ejected(const std::string& host, int port);
+
+private:
+    struct Pool;
+
+    Pool& pool_for(const std::string& host, int port);
+    // Replaces pool's addresses, keeping the state of those still present
+    void reset_endpoints(Pool& pool, const std::vector<std::string>& addresses);
+
+    Options opt_;
+    std::shared_ptr<DnsCache> dns_;
+    std::mutex mu_;
+    std::unordered_map<std::string, std::unique_ptr<Pool>> pools_;
+};
+
+} // namespace net
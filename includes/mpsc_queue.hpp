@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+
+namespace net {
+
+// Link field for MpscQueue; derive the queued type from it
+struct MpscNode {
+    std::atomic<MpscNode*> next{nullptr};
+};
+
+// Intrusive multi-producer / single-consumer queue (Vyukov). push() is one
+// atomic exchange plus a store and never blocks, so any number of threads can
+// submit without contending on a mutex. pop() is for the single consumer only.
+// The queue never owns its nodes.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T* item) { push_node(item); }
+
+    // Returns nullptr when empty. May also return nullptr while a producer is
+    // between its two steps; that producer's wakeup follows, so the consumer
+    // will come back for the item.
+    T* pop() {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) return nullptr;
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+        // tail is the last node: park the stub behind it so it can be handed out
+        push_node(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        return nullptr;
+    }
+
+private:
+    void push_node(MpscNode* n) {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    std::atomic<MpscNode*> head_;  // producers
+    MpscNode* tail_;               // consumer
+    MpscNode stub_;
+};
+
+} // namespace net
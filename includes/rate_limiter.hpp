@@ -0,0 +1,89 @@
+#pragma once
+#include "cancellation.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace net {
+
+// GCRA (generic cell rate algorithm) limiter. The whole state is one atomic
+// "theoretical arrival time", so any number of threads can share a limit
+// with a single CAS per request and no mutex.
+class RateLimiter {
+public:
+    RateLimiter(double rate_per_sec, double burst = 1.0);
+
+    // Reserves the next slot and returns how long the caller must wait before
+    // sending (zero if it may send now). Returns nullopt without reserving if
+    // the wait would exceed max_wait.
+    std::optional<std::chrono::nanoseconds> reserve(std::chrono::nanoseconds max_wait);
+    bool try_acquire() { return reserve(std::chrono::nanoseconds(0)).has_value(); }
+
+private:
+    int64_t interval_ns_;
+    int64_t tolerance_ns_;            // how far ahead of schedule a burst may run
+    std::atomic<int64_t> tat_{0};     // steady_clock ns
+};
+
+// Client-side QPS limits keyed on host or host + path prefix. Routes are fixed
+// at construction; per-host limiters for the default limit are created on
+// first use in an insert-only lock-free table, so the hot path never locks.
+// Share one instance across every client that must respect the quota.
+class HostRateLimiter {
+public:
+    struct Limit {
+        double rate_per_sec;
+        double burst;
+        Limit(double rate = 0, double b = 1.0) : rate_per_sec(rate), burst(b) {}
+    };
+
+    struct Options {
+        // "api.example.com" or "api.example.com/v1/search"; the longest
+        // matching prefix of host + path wins
+        std::vector<std::pair<std::string, Limit>> routes;
+        std::optional<Limit> per_host_default;  // applies to hosts without a route
+        long max_wait_ms;                       // longer waits fail instead of queueing
+        Options() : max_wait_ms(1000) {}
+    };
+
+    explicit HostRateLimiter(Options opt);
+    ~HostRateLimiter();
+
+    HostRateLimiter(const HostRateLimiter&) = delete;
+    HostRateLimiter& operator=(const HostRateLimiter&) = delete;
+
+    // Blocks until a request to host + path may be sent. Returns false if
+    // that would take longer than max_wait_ms.
+    bool acquire(const std::string& host, const std::string& path);
+    // Same with a tighter bound on the wait (e.g. the time left before a
+    // deadline). The sleep ends early, returning false, once cancel fires.
+    bool acquire(const std::string& host, const std::string& path, long max_wait_ms, const CancellationToken& cancel);
+
+    long max_wait_ms() const { return max_wait_ms_; }
+
+    // The limiter for host + path, or nullptr if unlimited
+    RateLimiter* limiter_for(const std::string& host, const std::string& path);
+
+private:
+    struct Node {
+        std::string host;
+        RateLimiter limiter;
+        Node* next;
+        Node(std::string h, const Limit& l, Node* n) : host(std::move(h)), limiter(l.rate_per_sec, l.burst), next(n) {}
+    };
+    static constexpr size_t kBuckets = 256;
+
+    RateLimiter* default_for(const std::string& host);
+
+    std::vector<std::pair<std::string, std::unique_ptr<RateLimiter>>> routes_;  // longest first
+    std::optional<Limit> default_;
+    long max_wait_ms_;
+    std::unique_ptr<std::atomic<Node*>[]> buckets_;
+};
+
+} // namespace net
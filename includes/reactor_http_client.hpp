@@ -0,0 +1,92 @@
+#pragma once
+#include "async_http_client.hpp"
+#include "request_scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace net {
+
+// Async client driven by the caller's own event loop (epoll, libuv, ...)
+// instead of a thread of its own, so outbound HTTP shares the reactor
+// threads that serve inbound sockets. Built on curl's socket interface: the
+// client tells the loop which sockets to watch and when to fire a timer, and
+// the loop reports readiness back.
+//
+// Not thread-safe: submit(), on_socket() and on_timeout() must all be called
+// on the reactor thread, and never from inside a Hooks callback. Completions
+// run inline on that thread.
+class ReactorHttpClient {
+public:
+    enum Events { None = 0, Read = 1, Write = 2 };
+
+    struct Hooks {
+        // Watch fd for events (Read | Write); None means stop watching it
+        std::function<void(curl_socket_t fd, int events)> watch;
+        // (Re)arm the single timer to call on_timeout() after timeout_ms;
+        // -1 disarms it. 0 means as soon as possible, but not from inside
+        // this callback.
+        std::function<void(long timeout_ms)> set_timer;
+        // Optional and called from any thread: a request's token was cancelled.
+        // Schedule on_timeout() on the reactor thread to abort it promptly;
+        // otherwise it is noticed the next time the client is driven.
+        std::function<void()> wake;
+    };
+
+    struct Options {
+        HttpClient::Options http;  // transfer settings only, as for AsyncHttpClient
+        size_t max_in_flight;
+        SchedulerOptions scheduler;
+        Options() : max_in_flight(64) {}
+    };
+
+    using Completion = AsyncHttpClient::Completion;
+
+    explicit ReactorHttpClient(Hooks hooks, Options opt = Options{});
+    // Fails everything queued or in flight with HttpError; fds are un-watched
+    ~ReactorHttpClient();
+
+    ReactorHttpClient(const ReactorHttpClient&) = delete;
+    ReactorHttpClient& operator=(const ReactorHttpClient&) = delete;
+
+    void submit(AsyncRequest req, Completion done);
+
+    // fd became ready for events (Read | Write); error = the loop reported
+    // an error or hang-up on it
+    void on_socket(curl_socket_t fd, int events, bool error = false);
+    void on_timeout();
+
+    size_t queued() const { return sched_.size(); }
+    size_t in_flight() const { return active_.size(); }
+
+private:
+    struct Job;
+    using JobPtr = std::unique_ptr<Job>;
+
+    static int socket_cb(CURL* easy, curl_socket_t fd, int what, void* userp, void* socketp);
+    static int timer_cb(CURLM* multi, long timeout_ms, void* userp);
+
+    void start_ready();
+    void abort_cancelled();
+    void arm_timer();
+    void reap();
+    void fail(JobPtr job, std::exception_ptr error);
+
+    Hooks hooks_;
+    Options opt_;
+    CURLM* multi_ = nullptr;
+    WeightedFairQueue<JobPtr> sched_;
+    std::unordered_map<CURL*, JobPtr> active_;
+    // Bumped by cancellation callbacks, which may run on other threads
+    std::shared_ptr<std::atomic<size_t>> cancels_;
+    // The one host timer serves both curl's timeout and the earliest
+    // time-to-first-byte limit (which may be stale, never late)
+    std::optional<std::chrono::steady_clock::time_point> curl_timer_at_;
+    std::optional<std::chrono::steady_clock::time_point> first_byte_due_;
+    bool closing_ = false;
+};
+
+} // namespace net
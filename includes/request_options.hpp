@@ -0,0 +1,39 @@
+#pragma once
+#include "cancellation.hpp"
+#include <chrono>
+#include <optional>
+
+namespace net {
+
+// Scheduling class for AsyncHttpClient. HttpClient runs one request at a time
+// and only uses it to decide who waits for a BandwidthBudget.
+enum class Priority { Interactive = 0, Batch = 1, Background = 2 };
+
+// Per-request settings, as opposed to HttpClient::Options which apply to every
+// request a client makes
+struct RequestOptions {
+    using Clock = std::chrono::steady_clock;
+
+    // Absolute deadline for the whole call, including retries and backoff.
+    // Each attempt's timeout is clamped to the time that remains.
+    std::optional<Clock::time_point> deadline;
+
+    // Aborts the transfer (and any pending retry) as soon as it is cancelled;
+    // the call then throws CancelledError
+    CancellationToken cancel;
+
+    Priority priority = Priority::Interactive;
+
+    // Override the client's max_recv_bps / max_send_bps for this request;
+    // 0 = use the client's
+    long max_recv_bps = 0;
+    long max_send_bps = 0;
+
+    static RequestOptions with_timeout(std::chrono::milliseconds budget) {
+        RequestOptions ro;
+        ro.deadline = Clock::now() + budget;
+        return ro;
+    }
+};
+
+} // namespace net
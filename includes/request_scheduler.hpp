@@ -0,0 +1,87 @@
+#pragma once
+#include "request_options.hpp"
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <utility>
+
+namespace net {
+
+struct SchedulerOptions {
+    // Relative share of dispatch slots per Priority class when all are
+    // backlogged; an idle class's share goes to the others
+    std::array<double, 3> weights;
+    SchedulerOptions() : weights{16.0, 4.0, 1.0} {}
+};
+
+// Weighted fair queue over the Priority classes (start-time fair queueing
+// with unit cost per request). FIFO within a class. Not thread-safe; owned by
+// the event loop that dispatches from it.
+template <typename T>
+class WeightedFairQueue {
+public:
+    explicit WeightedFairQueue(SchedulerOptions opt = {}) {
+        for (size_t c = 0; c < kClasses; ++c) stride_[c] = 1.0 / std::max(opt.weights[c], 1e-6);
+    }
+
+    void push(T item, Priority p) {
+        const auto c = static_cast<size_t>(p);
+        // A class that went idle restarts at the current virtual time rather
+        // than spending credit it banked while idle
+        const double start = std::max(vtime_, last_finish_[c]);
+        last_finish_[c] = start + stride_[c];
+        queues_[c].push_back({start, std::move(item)});
+        ++size_;
+    }
+
+    std::optional<T> pop() {
+        size_t best = kClasses;
+        for (size_t c = 0; c < kClasses; ++c) {
+            if (!queues_[c].empty() && (best == kClasses || queues_[c].front().tag < queues_[best].front().tag))
+                best = c;
+        }
+        if (best == kClasses) return std::nullopt;
+        auto entry = std::move(queues_[best].front());
+        queues_[best].pop_front();
+        --size_;
+        vtime_ = entry.tag;
+        return std::move(entry.item);
+    }
+
+    // Removes every item for which pred(item) is true, passing it to sink
+    template <typename Pred, typename Sink>
+    void remove_if(Pred pred, Sink sink) {
+        for (auto& q : queues_) {
+            for (auto it = q.begin(); it != q.end();) {
+                if (pred(it->item)) {
+                    sink(std::move(it->item));
+                    it = q.erase(it);
+                    --size_;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t size(Priority p) const { return queues_[static_cast<size_t>(p)].size(); }
+
+private:
+    static constexpr size_t kClasses = 3;
+    struct Entry {
+        double tag;
+        T item;
+    };
+
+    std::array<std::deque<Entry>, kClasses> queues_;
+    std::array<double, kClasses> stride_{};
+    std::array<double, kClasses> last_finish_{};
+    double vtime_ = 0;
+    size_t size_ = 0;
+};
+
+} // namespace net
@@ -0,0 +1,41 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+namespace net {
+
+struct Response {
+    long status = 0;
+    std::string body;
+    std::vector<std::pair<std::string, std::string>> headers;
+};
+
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+// ASCII case-insensitive comparison (header names)
+inline bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+// First header with the given name (case-insensitive), or nullptr
+inline const std::string* find_header(const HeaderList& headers, std::string_view name) {
+    for (auto& [k,v] : headers) {
+        if (iequals(k, name)) return &v;
+    }
+    return nullptr;
+}
+
+class HttpError : public std::runtime_error {
+public:
+    explicit HttpError(const std::string& what) : std::runtime_error(what) {}
+};
+
+} // namespace net
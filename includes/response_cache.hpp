@@ -0,0 +1,115 @@
+#pragma once
+#include "response.hpp"
+#include "singleflight.hpp"
+#include "disk_cache.hpp"
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace net {
+
+// Parsed Cache-Control response directives we act on
+struct CacheControl {
+    std::optional<long> max_age;  // seconds
+    bool no_store = false;
+    bool no_cache = false;        // may be stored, but must be revalidated before use
+    bool must_revalidate = false;
+    std::optional<long> stale_while_revalidate;  // seconds
+    std::optional<long> stale_if_error;          // seconds
+};
+
+CacheControl parse_cache_control(std::string_view value);
+
+// A stored response plus the metadata needed to decide freshness and revalidate
+struct CachedResponse {
+    using Clock = std::chrono::system_clock;
+
+    SharedResponse response;
+    Clock::time_point stored_at;  // already adjusted by the response's Age header
+    long max_age_s = 0;
+    long stale_while_revalidate_s = 0;  // beyond max_age, serve stale while refreshing
+    long stale_if_error_s = 0;          // beyond max_age, serve stale if the refresh fails
+    bool no_cache = false;
+    std::string etag;
+    std::string last_modified;
+    HeaderList vary;              // (lower-case request header name, value) the response varies on
+
+    bool is_fresh(Clock::time_point now) const;
+    bool usable_while_revalidating(Clock::time_point now) const;
+    bool usable_on_error(Clock::time_point now) const;
+    bool has_validators() const { return !etag.empty() || !last_modified.empty(); }
+    bool matches(const HeaderList& request_headers) const;
+    size_t size_bytes() const;
+};
+
+using SharedCachedResponse = std::shared_ptr<const CachedResponse>;
+
+// Sharded, size-bounded LRU of GET responses keyed on URL. Each URL holds the
+// most recent variant; a lookup whose Vary'd request headers differ is a miss.
+// With a DiskCache attached, stores are written through to disk and memory
+// misses are filled from it, so entries survive restarts. Filling copies the
+// body out of the mapping once; entries too large for a shard are not kept
+// but are shared while any caller still holds them.
+// Thread-safe; share one instance between clients.
+class ResponseCache {
+public:
+    struct Options {
+        size_t max_bytes;   // total budget across shards (body + headers)
+        size_t shards;
+        std::shared_ptr<DiskCache> disk;  // optional second tier
+        Options() : max_bytes(64u << 20), shards(16) {}
+    };
+
+    ResponseCache();
+    explicit ResponseCache(Options opt);
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    SharedCachedResponse lookup(const std::string& url, const HeaderList& request_headers);
+    void store(const std::string& url, SharedCachedResponse entry);
+    void erase(const std::string& url);
+
+    size_t size_bytes() const;
+    size_t entries() const;
+
+    // Builds a cache entry, or nullptr if the response must not be stored
+    // (no-store, Vary: *, uncacheable status, or neither freshness nor validators)
+    static SharedCachedResponse make_entry(SharedResponse resp, const HeaderList& request_headers);
+    // Entry for a 304: same stored body, freshness and validators refreshed
+    // from the 304's headers
+    static SharedCachedResponse revalidated(const CachedResponse& old, const Response& not_modified);
+
+private:
+    struct Shard {
+        mutable std::mutex mu;
+        std::list<std::pair<std::string, SharedCachedResponse>> lru;  // front = most recent
+        std::unordered_map<std::string, decltype(lru)::iterator> index;
+        size_t bytes = 0;
+        // Entries over the shard budget, shared for as long as a caller
+        // holds them so repeated disk hits don't each copy the body
+        std::unordered_map<std::string, std::weak_ptr<const CachedResponse>> oversize;
+        size_t oversize_sweep_at = 16;
+    };
+
+    Shard& shard_for(const std::string& url);
+    void evict_locked(Shard& sh);
+    // Returns the entry it replaced, if any
+    SharedCachedResponse insert_memory(const std::string& url, SharedCachedResponse entry);
+    void erase_memory(const std::string& url);
+    void hold_oversize(const std::string& url, const SharedCachedResponse& entry);
+    SharedCachedResponse load_from_disk(const std::string& url);
+
+    size_t shard_budget_ = 0;
+    std::shared_ptr<DiskCache> disk_;
+    std::vector<Shard> shards_;
+};
+
+} // namespace net
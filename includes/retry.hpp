@@ -0,0 +1,74 @@
+#pragma once
+#include <curl/curl.h>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+namespace net {
+
+// Token-bucket retry budget. Every original request deposits `ratio` tokens,
+// every retry withdraws one. Share a single instance across clients so that
+// retries stay a bounded fraction of traffic and cannot amplify an outage.
+class RetryBudget {
+public:
+    struct Options {
+        double ratio;        // tokens deposited per original request
+        double max_tokens;   // bucket capacity (also the initial fill)
+        Options() : ratio(0.1), max_tokens(10.0) {}
+    };
+
+    RetryBudget();
+    explicit RetryBudget(Options opt);
+
+    // Called once per logical request (not per attempt)
+    void deposit();
+    // Returns true and consumes a token if a retry is allowed
+    bool try_withdraw();
+    double tokens() const;
+
+private:
+    // Fixed-point (1/1000 token) so updates are a single atomic CAS
+    static constexpr long long kScale = 1000;
+    long long deposit_ = 0;
+    long long capacity_ = 0;
+    std::atomic<long long> tokens_{0};
+};
+
+struct RetryPolicy {
+    int max_attempts;                   // 1 = no retries
+    std::vector<CURLcode> retryable_curl_codes;
+    std::vector<long> retryable_statuses;
+    long initial_backoff_ms;
+    long max_backoff_ms;
+    double backoff_multiplier;
+    bool honor_retry_after;
+    long max_retry_after_ms;            // give up if the server asks for longer
+    bool retry_non_idempotent;          // POST is only retried when set
+    std::shared_ptr<RetryBudget> budget;
+
+    RetryPolicy()
+        : max_attempts(1),
+          retryable_curl_codes{CURLE_COULDNT_RESOLVE_HOST, CURLE_COULDNT_CONNECT,
+                               CURLE_OPERATION_TIMEDOUT, CURLE_SEND_ERROR,
+                               CURLE_RECV_ERROR, CURLE_GOT_NOTHING},
+          retryable_statuses{429, 502, 503, 504},
+          initial_backoff_ms(100),
+          max_backoff_ms(10000),
+          backoff_multiplier(2.0),
+          honor_retry_after(true),
+          max_retry_after_ms(30000),
+          retry_non_idempotent(false) {}
+
+    bool is_retryable(CURLcode code) const;
+    bool is_retryable_status(long status) const;
+    // Exponential backoff with full jitter: uniform in [0, min(max, initial * mult^(attempt-1))]
+    long backoff_ms(int attempt) const;
+};
+
+// Parses a Retry-After value (delta-seconds or HTTP-date) into milliseconds from now
+std::optional<long> parse_retry_after_ms(std::string_view value);
+
+} // namespace net
@@ -0,0 +1,66 @@
+#pragma once
+#include "response.hpp"
+#include "cancellation.hpp"
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace net {
+
+using SharedResponse = std::shared_ptr<const Response>;
+
+// Collapses identical concurrent requests into one upstream transfer. The
+// first caller for a key runs the fetch; callers arriving while it is in
+// flight wait and receive the same immutable Response (or the same exception).
+// If the fetch fails because the leader itself was cancelled or ran out of
+// time, waiters are not failed with it: one of them runs the fetch again.
+// Share one instance between all clients that should coalesce.
+class RequestCoalescer {
+public:
+    // Names of request headers that distinguish otherwise identical requests
+    // (case-insensitive). Empty means every request header is part of the key.
+    explicit RequestCoalescer(std::vector<std::string> vary_headers = {});
+
+    RequestCoalescer(const RequestCoalescer&) = delete;
+    RequestCoalescer& operator=(const RequestCoalescer&) = delete;
+
+    // deadline and cancel are the caller's own (fetch is expected to honour
+    // them too). A waiter whose deadline passes stops waiting and gets
+    // HttpError, one that is cancelled gets CancelledError; the shared fetch
+    // keeps running for the others.
+    SharedResponse run(const std::string& key, const std::function<Response()>& fetch,
+                       std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt,
+                       const CancellationToken& cancel = {});
+
+    std::string make_key(std::string_view method, std::string_view url,
+                         const std::vector<std::pair<std::string, std::string>>& headers) const;
+
+    // Number of keys currently in flight (diagnostics)
+    size_t in_flight() const;
+
+private:
+    static constexpr size_t kShards = 16;
+    struct Call;
+    struct Shard {
+        mutable std::mutex mu;
+        std::unordered_map<std::string, std::shared_ptr<Call>> calls;
+    };
+
+    Shard& shard_for(const std::string& key);
+    // Waits for call; nullptr if its leader gave up and the caller should retry
+    static SharedResponse follow(const std::shared_ptr<Call>& call,
+                                 std::optional<std::chrono::steady_clock::time_point> deadline,
+                                 const CancellationToken& cancel);
+
+    std::vector<std::string> vary_;  // lower-cased
+    std::array<Shard, kShards> shards_;
+};
+
+} // namespace net
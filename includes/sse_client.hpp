@@ -0,0 +1,94 @@
+#pragma once
+#include "http_client.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace net {
+
+struct SseEvent {
+    std::string id;      // last event ID in effect when the event was dispatched
+    std::string event;   // "message" unless the server named it
+    std::string data;    // data lines joined with '\n'
+    std::optional<long> retry_ms;  // reconnection time, if this event set one
+};
+
+// Incremental text/event-stream parser (WHATWG HTML, "Server-sent events").
+// Chunks may split lines, CRLF pairs and UTF-8 sequences anywhere.
+class SseParser {
+public:
+    // Return false to stop parsing; feed() then returns false too
+    using Handler = std::function<bool(const SseEvent&)>;
+
+    // A line or an event's data longer than this throws HttpError rather
+    // than growing without bound
+    explicit SseParser(size_t max_event_bytes = 64u << 20) : max_(max_event_bytes) {}
+
+    bool feed(std::string_view chunk, const Handler& on_event);
+
+    // A new connection: drops any partial line or event, keeps the last
+    // event ID and reconnection time
+    void reset();
+
+    const std::string& last_event_id() const { return last_id_; }
+    std::optional<long> retry_ms() const { return retry_; }
+
+private:
+    bool line(std::string_view l, const Handler& on_event);
+
+    // Larger "retry:" values are clamped (about 24 days; fits any long)
+    static constexpr int64_t kMaxRetryMs = INT32_MAX;
+
+    std::string partial_;       // line still missing its terminator
+    bool skip_lf_ = false;      // last chunk ended on '\r'
+    bool first_line_ = true;    // may start with a BOM
+    std::string data_;
+    std::string event_type_;
+    bool retry_set_ = false;    // in the event being built
+    std::string last_id_;
+    std::optional<long> retry_;
+    SseEvent ev_;               // reused for every dispatch
+    size_t max_;
+};
+
+// Subscribes to an SSE endpoint over one long-lived GET instead of polling.
+// Dropped connections are re-established after the server's retry time
+// (backing off while reconnects keep failing), sending Last-Event-ID so the
+// server can replay what was missed.
+class SseClient {
+public:
+    struct Options {
+        HttpClient::Options http;   // timeout_ms is ignored: streams are open-ended
+        long retry_ms;              // until the server sends "retry:"
+        long max_retry_ms;          // cap for the backoff on consecutive failures
+        int max_reconnects;         // in a row without an event; -1 = unlimited
+        size_t max_event_bytes;     // longest line or event data accepted
+        Options() : retry_ms(3000), max_retry_ms(30000), max_reconnects(-1), max_event_bytes(64u << 20) {}
+    };
+
+    SseClient();
+    explicit SseClient(Options opt);
+
+    // Blocks, calling on_event for every event, until on_event returns false,
+    // ro.cancel fires, or the server answers 204 (all return normally). A
+    // non-200 answer or a body that is not text/event-stream throws HttpError
+    // (before any of it is parsed), as do an event over max_event_bytes and
+    // running out of max_reconnects.
+    void subscribe(const std::string& url,
+                   const std::function<bool(const SseEvent&)>& on_event,
+                   const std::vector<std::pair<std::string,std::string>>& headers = {},
+                   const RequestOptions& ro = {});
+
+    // Resume point for a later subscribe() (sent as Last-Event-ID)
+    const std::string& last_event_id() const { return parser_.last_event_id(); }
+
+private:
+    Options opt_;
+    HttpClient http_;
+    SseParser parser_;
+};
+
+} // namespace net
@@ -0,0 +1,65 @@
+#pragma once
+#include <curl/curl.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace net {
+
+// TLS session tickets that survive process restarts, so the first
+// connections after a deploy resume (abbreviated handshake) instead of doing
+// a full one. Clients export their sessions into the store when destroyed;
+// the store writes them to one file when save() is called or it is destroyed,
+// and a new process loads that file and imports it into each client it is
+// given to. Share one store between every client in the process. Thread-safe.
+//
+// Needs libcurl 8.12+ built with SSLS-EXPORT (curl_easy_ssls_export/import);
+// otherwise import/export are no-ops and supported() is false. The file
+// holds session secrets and is created owner-read/write only.
+class TlsSessionStore {
+public:
+    struct Options {
+        std::string path;
+        size_t max_entries;   // newest-expiring sessions are kept on overflow
+        Options() : max_entries(1024) {}
+    };
+
+    // Loads opt.path if it exists; a missing, foreign or torn file is ignored
+    explicit TlsSessionStore(Options opt);
+    // Calls save()
+    ~TlsSessionStore();
+
+    TlsSessionStore(const TlsSessionStore&) = delete;
+    TlsSessionStore& operator=(const TlsSessionStore&) = delete;
+
+    static bool supported();
+
+    // Imports every unexpired session into h's session cache (h needs a share
+    // with CURL_LOCK_DATA_SSL_SESSION, as HttpClient sets up)
+    void import_into(CURL* h) const;
+    // Copies h's current sessions into the store, replacing older ones
+    void export_from(CURL* h);
+
+    // Writes the store to disk atomically (temp file + rename)
+    bool save() const;
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string session_key;  // may be empty when curl only exports the hash
+        std::string shmac;
+        std::string data;
+        int64_t valid_until = 0;  // unix seconds; 0 = unknown
+    };
+
+    void load();
+
+    Options opt_;
+    mutable std::mutex mu_;
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+} // namespace net
@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+namespace net {
+
+struct UrlParts {
+    std::string scheme;
+    std::string host;   // lower-case, no brackets for IPv6
+    long port = 0;      // explicit or scheme default
+    std::string path;   // at least "/"
+};
+
+// Splits an absolute URL with libcurl's URL parser; throws HttpError if it is malformed
+UrlParts split_url(const std::string& url);
+
+} // namespace net
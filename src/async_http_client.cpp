@@ -0,0 +1,458 @@
+#include "async_http_client.hpp"
+#include "curl_common.hpp"
+#include "mpsc_queue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+
+struct AsyncHttpClient::Job : MpscNode, detail::AsyncTransfer {
+    uint64_t cancel_id = 0;
+    ~Job() {
+        if (cancel_id) req.ro.cancel.remove_callback(cancel_id);
+    }
+};
+
+struct AsyncHttpClient::Loop {
+    size_t index = 0;
+    CURLM* multi = nullptr;
+    std::shared_ptr<Wake> wake;
+
+    // submit() pushes here without locking; the owner moves jobs into sched
+    MpscQueue<Job> inbox;
+    std::atomic<bool> notified{false};  // a wakeup is already pending
+
+    // Guards sched between the owner and thieves
+    std::mutex mu;
+    WeightedFairQueue<JobPtr> sched;
+
+    // Owner-thread state
+    std::unordered_map<CURL*, JobPtr> active;
+    std::chrono::steady_clock::time_point next_sweep{};
+    // Earliest first_byte_by among active jobs; may be stale, never late
+    std::optional<std::chrono::steady_clock::time_point> first_byte_due;
+
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> in_flight{0};
+    std::atomic<bool> rescan{false};  // a peer saw a cancellation
+    std::thread thread;
+
+    explicit Loop(const SchedulerOptions& so) : sched(so) {}
+};
+
+// Longest a loop sleeps while requests are queued, so queued deadlines are
+// noticed without a dedicated timer
+static constexpr long kQueueSweepMs = 50;
+static constexpr long kIdlePollMs = 1000;
+
+// Wakes the loop out of curl_multi_poll. On Linux an eventfd passed to the
+// poll as an extra descriptor; elsewhere curl's own wakeup pipe.
+void AsyncHttpClient::signal(Wake& w) {
+#if defined(__linux__)
+    if (w.event_fd >= 0) {
+        const uint64_t one = 1;
+        (void)!write(w.event_fd, &one, sizeof(one));
+        return;
+    }
+#endif
+    if (w.multi) curl_multi_wakeup(w.multi);
+}
+
+// scheme://authority of url, so every request for one host:port lands on
+// the loop that already holds connections to it
+static std::string_view shard_key(std::string_view url) {
+    auto begin = url.find("://");
+    begin = begin == std::string_view::npos ? 0 : begin + 3;
+    const auto end = url.find_first_of("/?#", begin);
+    return url.substr(0, end);
+}
+
+static void pin_current_thread(int cpu) {
+    if (cpu < 0) return;
+#if defined(_WIN32)
+    if (cpu < 64) SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+AsyncHttpClient::AsyncHttpClient() : AsyncHttpClient(Options{}) {}
+
+AsyncHttpClient::AsyncHttpClient(Options opt) : opt_(std::move(opt)) {
+    detail::global_init_once();
+    if (opt_.max_in_flight == 0) opt_.max_in_flight = 1;
+    if (opt_.event_loops == 0) opt_.event_loops = 1;
+    for (size_t i = 0; i < opt_.event_loops; ++i) {
+        auto loop = std::make_unique<Loop>(opt_.scheduler);
+        loop->index = i;
+        loop->multi = curl_multi_init();
+        if (!loop->multi) {
+            for (auto& l : loops_) curl_multi_cleanup(l->multi);
+            throw HttpError("curl_multi_init failed");
+        }
+        detail::apply_pool_options(loop->multi, opt_.http);
+        loop->wake = std::make_shared<Wake>();
+        loop->wake->multi = loop->multi;
+#if defined(__linux__)
+        loop->wake->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+        loops_.push_back(std::move(loop));
+    }
+    // Threads start only once every loop exists, since they may steal from each other
+    for (auto& l : loops_) {
+        Loop* loop = l.get();
+        loop->thread = std::thread([this, loop]{
+            if (!opt_.cpu_affinity.empty())
+                pin_current_thread(opt_.cpu_affinity[loop->index % opt_.cpu_affinity.size()]);
+            run(*loop);
+        });
+    }
+}
+
+AsyncHttpClient::~AsyncHttpClient() {
+    stop_.store(true, std::memory_order_release);
+    for (auto& l : loops_) signal(*l->wake);
+    for (auto& l : loops_) {
+        if (l->thread.joinable()) l->thread.join();
+    }
+    // Fail submissions that raced with stop_ and landed after a loop exited
+    for (auto& l : loops_) shutdown(*l);
+    for (auto& l : loops_) {
+        {
+            std::lock_guard<std::mutex> lk(l->wake->mu);
+            l->wake->multi = nullptr;
+#if defined(__linux__)
+            if (l->wake->event_fd >= 0) close(l->wake->event_fd);
+            l->wake->event_fd = -1;
+#endif
+        }
+        curl_multi_cleanup(l->multi);
+    }
+}
+
+size_t AsyncHttpClient::queued() const {
+    size_t n = 0;
+    for (auto& l : loops_) n += l->queued.load(std::memory_order_relaxed);
+    return n;
+}
+
+size_t AsyncHttpClient::in_flight() const {
+    size_t n = 0;
+    for (auto& l : loops_) n += l->in_flight.load(std::memory_order_relaxed);
+    return n;
+}
+
+void AsyncHttpClient::submit(AsyncRequest req, Completion done) {
+    auto job = std::make_unique<Job>();
+    job->req = std::move(req);
+    job->done = std::move(done);
+    Loop& loop = *loops_[std::hash<std::string_view>{}(shard_key(job->req.url)) % loops_.size()];
+    if (job->req.ro.cancel.valid()) {
+        // The callback may run on another thread after this client is gone,
+        // so it only touches the shared wake state. A stolen job still wakes
+        // its home loop, which then nudges the others.
+        job->cancel_id = job->req.ro.cancel.add_callback([w = loop.wake]{
+            std::lock_guard<std::mutex> lk(w->mu);
+            w->cancels.fetch_add(1, std::memory_order_relaxed);
+            signal(*w);
+        });
+    }
+    if (stop_.load(std::memory_order_acquire)) {
+        fail(std::move(job), std::make_exception_ptr(HttpError("client is shutting down")));
+        return;
+    }
+    loop.queued.fetch_add(1, std::memory_order_relaxed);
+    loop.inbox.push(job.release());
+    notify(loop);
+    if (opt_.work_stealing && loop.in_flight.load(std::memory_order_relaxed) >= opt_.max_in_flight)
+        wake_idle_peer(loop);
+}
+
+std::future<Response> AsyncHttpClient::get(const std::string& url, const HeaderList& headers,
+                                           const RequestOptions& ro) {
+    AsyncRequest req;
+    req.url = url;
+    req.headers = headers;
+    req.ro = ro;
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto fut = promise->get_future();
+    submit(std::move(req), [promise](AsyncResult r) {
+        if (r.error) promise->set_exception(r.error);
+        else promise->set_value(std::move(r.response));
+    });
+    return fut;
+}
+
+std::future<Response> AsyncHttpClient::post(const std::string& url, std::string data, const HeaderList& headers,
+                                            const RequestOptions& ro) {
+    AsyncRequest req;
+    req.method = "POST";
+    req.url = url;
+    req.headers = headers;
+    req.body = std::move(data);
+    req.ro = ro;
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto fut = promise->get_future();
+    submit(std::move(req), [promise](AsyncResult r) {
+        if (r.error) promise->set_exception(r.error);
+        else promise->set_value(std::move(r.response));
+    });
+    return fut;
+}
+
+void AsyncHttpClient::notify(Loop& loop) {
+    // Only the first submission since the loop last looked pays for a syscall
+    if (!loop.notified.exchange(true, std::memory_order_acq_rel)) signal(*loop.wake);
+}
+
+void AsyncHttpClient::drain_inbox(Loop& loop) {
+    // Clear before draining: a push that this drain misses will signal again
+    loop.notified.exchange(false, std::memory_order_acq_rel);
+    Job* first = loop.inbox.pop();
+    if (!first) return;
+    std::lock_guard<std::mutex> lk(loop.mu);
+    for (Job* j = first; j; j = loop.inbox.pop()) {
+        JobPtr job(j);
+        const auto p = job->req.ro.priority;
+        loop.sched.push(std::move(job), p);
+    }
+}
+
+void AsyncHttpClient::run(Loop& loop) {
+#if defined(__linux__)
+    curl_waitfd extra{};
+    extra.fd = loop.wake->event_fd;
+    extra.events = CURL_WAIT_POLLIN;
+    const unsigned extra_count = extra.fd >= 0 ? 1u : 0u;
+#endif
+    while (!stop_.load(std::memory_order_acquire)) {
+        drain_inbox(loop);
+        const auto now = std::chrono::steady_clock::now();
+        if (loop.wake->cancels.exchange(0, std::memory_order_relaxed) > 0) {
+            // The token may belong to a job another loop stole
+            for (auto& peer : loops_) {
+                if (peer.get() == &loop) continue;
+                peer->rescan.store(true, std::memory_order_relaxed);
+                signal(*peer->wake);
+            }
+            loop.next_sweep = now;
+        }
+        if (loop.rescan.exchange(false, std::memory_order_relaxed)) loop.next_sweep = now;
+        if (loop.first_byte_due && *loop.first_byte_due <= now) loop.next_sweep = now;
+        if (now >= loop.next_sweep) {
+            sweep_queue(loop);
+            abort_cancelled(loop);
+            loop.next_sweep = now + std::chrono::milliseconds(kQueueSweepMs);
+        }
+        start_ready(loop);
+
+        int running = 0;
+        curl_multi_perform(loop.multi, &running);
+        reap(loop);
+
+        long timeout = kIdlePollMs;
+        long curl_timeout = -1;
+        curl_multi_timeout(loop.multi, &curl_timeout);
+        if (curl_timeout >= 0) timeout = std::min(timeout, curl_timeout);
+        if (loop.queued.load(std::memory_order_relaxed) > 0) {
+            timeout = std::min(timeout, kQueueSweepMs);
+            // Something may have completed during reap(); go straight round again
+            if (loop.active.size() < opt_.max_in_flight) timeout = 0;
+        }
+        if (loop.first_byte_due) {
+            // Wake for the earliest time-to-first-byte limit
+            const auto left = *loop.first_byte_due - std::chrono::steady_clock::now();
+            const long ms = static_cast<long>(std::chrono::ceil<std::chrono::milliseconds>(left).count());
+            timeout = std::max(0L, std::min(timeout, ms));
+        }
+#if defined(__linux__)
+        extra.revents = 0;
+        curl_multi_poll(loop.multi, extra_count ? &extra : nullptr, extra_count, static_cast<int>(timeout), nullptr);
+        if (extra.revents) {
+            uint64_t n;
+            (void)!read(extra.fd, &n, sizeof(n));
+        }
+#else
+        curl_multi_poll(loop.multi, nullptr, 0, static_cast<int>(timeout), nullptr);
+#endif
+    }
+    shutdown(loop);
+}
+
+void AsyncHttpClient::sweep_queue(Loop& loop) {
+    const auto now = RequestOptions::Clock::now();
+    std::vector<JobPtr> dead;
+    {
+        std::lock_guard<std::mutex> lk(loop.mu);
+        loop.sched.remove_if([&](const JobPtr& j) { return j->cancelled() || j->expired(now); },
+                             [&](JobPtr j) { dead.push_back(std::move(j)); });
+        loop.queued.fetch_sub(dead.size(), std::memory_order_relaxed);
+    }
+    for (auto& j : dead) {
+        if (j->cancelled()) fail(std::move(j), std::make_exception_ptr(CancelledError("request cancelled")));
+        else fail(std::move(j), std::make_exception_ptr(HttpError("deadline exceeded")));
+    }
+}
+
+void AsyncHttpClient::abort_cancelled(Loop& loop) {
+    const auto now = std::chrono::steady_clock::now();
+    loop.first_byte_due.reset();
+    for (auto it = loop.active.begin(); it != loop.active.end();) {
+        Job& j = *it->second;
+        if (j.cancelled() || j.first_byte_overdue(now)) {
+            auto job = std::move(it->second);
+            it = loop.active.erase(it);
+            curl_multi_remove_handle(loop.multi, job->h);
+            loop.in_flight.fetch_sub(1, std::memory_order_relaxed);
+            if (job->cancelled()) fail(std::move(job), std::make_exception_ptr(CancelledError("request cancelled")));
+            else fail(std::move(job), std::make_exception_ptr(HttpError("time to first byte exceeded")));
+        } else {
+            if (j.first_byte_by && (!loop.first_byte_due || *j.first_byte_by < *loop.first_byte_due))
+                loop.first_byte_due = j.first_byte_by;
+            ++it;
+        }
+    }
+}
+
+void AsyncHttpClient::start_ready(Loop& loop) {
+    // Jobs are popped under the lock but started outside it, so submit() and
+    // thieves are never blocked behind curl handle setup
+    std::vector<JobPtr> ready;
+    {
+        std::lock_guard<std::mutex> lk(loop.mu);
+        while (loop.active.size() + ready.size() < opt_.max_in_flight) {
+            auto job = loop.sched.pop();
+            if (!job) break;
+            ready.push_back(std::move(*job));
+        }
+        loop.queued.fetch_sub(ready.size(), std::memory_order_relaxed);
+    }
+    for (auto& job : ready) {
+        if (start(loop, std::move(job))) loop.in_flight.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (opt_.work_stealing && ready.empty() && loop.active.size() < opt_.max_in_flight) steal(loop);
+}
+
+size_t AsyncHttpClient::steal(Loop& thief) {
+    const size_t n = loops_.size();
+    for (size_t k = 1; k < n; ++k) {
+        Loop& victim = *loops_[(thief.index + k) % n];
+        const size_t backlog = victim.queued.load(std::memory_order_relaxed);
+        if (backlog == 0) continue;
+        // Take half the backlog, at most what fits, so two idle loops
+        // don't ping-pong a single request
+        const size_t want = std::min(opt_.max_in_flight - thief.active.size(), (backlog + 1) / 2);
+        std::vector<JobPtr> taken;
+        {
+            std::lock_guard<std::mutex> lk(victim.mu);
+            while (taken.size() < want) {
+                auto job = victim.sched.pop();
+                if (!job) break;
+                taken.push_back(std::move(*job));
+            }
+            victim.queued.fetch_sub(taken.size(), std::memory_order_relaxed);
+        }
+        if (taken.empty()) continue;
+        stolen_.fetch_add(taken.size(), std::memory_order_relaxed);
+        for (auto& job : taken) {
+            if (start(thief, std::move(job))) thief.in_flight.fetch_add(1, std::memory_order_relaxed);
+        }
+        return taken.size();
+    }
+    return 0;
+}
+
+void AsyncHttpClient::wake_idle_peer(const Loop& busy) {
+    const size_t n = loops_.size();
+    for (size_t k = 1; k < n; ++k) {
+        Loop& peer = *loops_[(busy.index + k) % n];
+        if (peer.queued.load(std::memory_order_relaxed) == 0 &&
+            peer.in_flight.load(std::memory_order_relaxed) < opt_.max_in_flight) {
+            signal(*peer.wake);
+            return;
+        }
+    }
+}
+
+bool AsyncHttpClient::start(Loop& loop, JobPtr job) {
+    try {
+        detail::prepare_transfer(*job, opt_.http);
+    } catch (...) {
+        fail(std::move(job), std::current_exception());
+        return false;
+    }
+    CURL* h = job->h;
+    if (curl_multi_add_handle(loop.multi, h) != CURLM_OK) {
+        fail(std::move(job), std::make_exception_ptr(HttpError("curl_multi_add_handle failed")));
+        return false;
+    }
+    if (job->first_byte_by && (!loop.first_byte_due || *job->first_byte_by < *loop.first_byte_due))
+        loop.first_byte_due = job->first_byte_by;
+    loop.active.emplace(h, std::move(job));
+    return true;
+}
+
+void AsyncHttpClient::reap(Loop& loop) {
+    int left = 0;
+    while (CURLMsg* msg = curl_multi_info_read(loop.multi, &left)) {
+        if (msg->msg == CURLMSG_DONE) finish(loop, msg->easy_handle, msg->data.result);
+    }
+}
+
+void AsyncHttpClient::finish(Loop& loop, CURL* h, CURLcode res) {
+    auto it = loop.active.find(h);
+    if (it == loop.active.end()) return;
+    auto job = std::move(it->second);
+    loop.active.erase(it);
+    curl_multi_remove_handle(loop.multi, h);
+    loop.in_flight.fetch_sub(1, std::memory_order_relaxed);
+
+    auto r = detail::transfer_result(*job, res);
+    auto done = std::move(job->done);
+    job.reset();
+    detail::deliver(std::move(done), std::move(r));
+}
+
+void AsyncHttpClient::fail(JobPtr job, std::exception_ptr error) {
+    auto done = std::move(job->done);
+    job.reset();
+    AsyncResult r;
+    r.error = std::move(error);
+    detail::deliver(std::move(done), std::move(r));
+}
+
+void AsyncHttpClient::shutdown(Loop& loop) {
+    drain_inbox(loop);
+    const auto error = std::make_exception_ptr(HttpError("client destroyed before request completed"));
+    std::vector<JobPtr> dead;
+    {
+        std::lock_guard<std::mutex> lk(loop.mu);
+        loop.sched.remove_if([](const JobPtr&) { return true; }, [&](JobPtr j) { dead.push_back(std::move(j)); });
+        loop.queued.fetch_sub(dead.size(), std::memory_order_relaxed);
+    }
+    for (auto& j : dead) fail(std::move(j), error);
+    for (auto& kv : loop.active) {
+        curl_multi_remove_handle(loop.multi, kv.first);
+        loop.in_flight.fetch_sub(1, std::memory_order_relaxed);
+        fail(std::move(kv.second), error);
+    }
+    loop.active.clear();
+}
+
+} // namespace net
@@ -0,0 +1,29 @@
+#include "bandwidth_budget.hpp"
+#include <algorithm>
+
+namespace net {
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BandwidthBudget::BandwidthBudget(Options opt)
+    : ns_per_byte_(opt.bytes_per_sec > 0 ? 1e9 / opt.bytes_per_sec : 0),
+      tolerance_ns_(static_cast<int64_t>(ns_per_byte_ * std::max(opt.burst_bytes, 0.0))) {}
+
+std::chrono::nanoseconds BandwidthBudget::charge(size_t bytes, Priority priority) {
+    if (ns_per_byte_ == 0) return std::chrono::nanoseconds(0);
+    const int64_t now = now_ns();
+    const int64_t cost = static_cast<int64_t>(ns_per_byte_ * static_cast<double>(bytes));
+    int64_t tat = tat_.load(std::memory_order_relaxed);
+    for (;;) {
+        const int64_t next = std::max(tat, now) + cost;
+        if (tat_.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+            if (priority == Priority::Interactive) return std::chrono::nanoseconds(0);
+            return std::chrono::nanoseconds(std::max<int64_t>(0, next - tolerance_ns_ - now));
+        }
+    }
+}
+
+} // namespace net
@@ -0,0 +1,83 @@
+#include "cache_refresher.hpp"
+
+namespace net {
+
+static HttpClient::Options worker_options(HttpClient::Options opt) {
+    opt.refresher.reset();  // the worker always refreshes inline
+    return opt;
+}
+
+CacheRefresher::CacheRefresher(HttpClient::Options opt, size_t max_queue)
+    : max_queue_(max_queue),
+      client_(worker_options(std::move(opt))),
+      worker_([this]{ run(); }) {}
+
+CacheRefresher::~CacheRefresher() {
+    CancellationSource in_flight;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+        in_flight = in_flight_;
+    }
+    // Aborts a revalidation in progress instead of waiting out its timeout
+    in_flight.cancel();
+    cv_.notify_all();
+    worker_.join();
+}
+
+// Identifies the cached variant: the URL plus the request's Vary'd header values
+static std::string variant_key(const std::string& url, const HeaderList& headers, const HeaderList& vary) {
+    std::string key = url;
+    for (auto& field : vary) {
+        const std::string* v = find_header(headers, field.first);
+        key += '\n';
+        key += field.first;
+        key += ": ";
+        if (v) key += *v;
+    }
+    return key;
+}
+
+bool CacheRefresher::schedule(const std::string& url, const HeaderList& headers, const HeaderList& vary) {
+    std::string key = variant_key(url, headers, vary);
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stop_) return false;
+        if (queued_.count(key)) return true;
+        if (queue_.size() >= max_queue_) return false;
+        queued_.insert(key);
+        queue_.push_back(Job{std::move(key), url, headers});
+    }
+    cv_.notify_one();
+    return true;
+}
+
+size_t CacheRefresher::pending() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return queued_.size();
+}
+
+void CacheRefresher::run() {
+    for (;;) {
+        Job job;
+        RequestOptions ro;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [this]{ return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+            in_flight_ = CancellationSource();
+            ro.cancel = in_flight_.token();
+        }
+        try {
+            client_.revalidate(job.url, job.headers, ro);
+        } catch (const std::exception&) {
+            // The stale entry stays in place; the next request retries
+        }
+        std::lock_guard<std::mutex> lk(mu_);
+        queued_.erase(job.key);
+    }
+}
+
+} // namespace net
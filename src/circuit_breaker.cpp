@@ -0,0 +1,151 @@
+#include "circuit_breaker.hpp"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace net {
+
+using Clock = std::chrono::steady_clock;
+
+class CircuitBreaker::Host {
+public:
+    explicit Host(const Options& opt) : opt_(opt) {}
+
+    // Returns {admitted, half-open round of a probe or 0}
+    std::pair<bool, uint64_t> admit() {
+        std::lock_guard<std::mutex> lk(mu_);
+        const auto now = Clock::now();
+        if (state_ == State::Open) {
+            if (now < opened_at_ + std::chrono::milliseconds(opt_.open_ms)) return {false, 0};
+            state_ = State::HalfOpen;
+            ++round_;
+            probes_in_flight_ = 0;
+            probes_ok_ = 0;
+        }
+        if (state_ == State::HalfOpen) {
+            if (probes_in_flight_ + probes_ok_ >= opt_.half_open_probes) return {false, 0};
+            ++probes_in_flight_;
+            return {true, round_};
+        }
+        return {true, 0};
+    }
+
+    void record(uint64_t round, bool success, long latency_ms) {
+        std::lock_guard<std::mutex> lk(mu_);
+        const auto now = Clock::now();
+        const bool slow = opt_.slow_call_ms > 0 && latency_ms >= opt_.slow_call_ms;
+        if (round) {
+            // A probe from an earlier half-open round no longer counts
+            if (round != round_) return;
+            probes_in_flight_ = std::max(0, probes_in_flight_ - 1);
+            if (state_ != State::HalfOpen) return;
+            if (!success || slow) {
+                trip(now);
+            } else if (++probes_ok_ >= opt_.half_open_probes) {
+                state_ = State::Closed;
+                buckets_ = {};
+            }
+            return;
+        }
+        if (state_ != State::Closed) return;  // late result from before the trip
+
+        Bucket& b = bucket_at(now);
+        ++b.calls;
+        if (!success) ++b.failures;
+        if (slow) ++b.slow;
+
+        Bucket sum;
+        for (auto& x : buckets_) {
+            if (now - x.start < std::chrono::milliseconds(opt_.window_ms)) {
+                sum.calls += x.calls;
+                sum.failures += x.failures;
+                sum.slow += x.slow;
+            }
+        }
+        if (sum.calls < opt_.min_calls) return;
+        if (sum.failures >= opt_.failure_rate_threshold * sum.calls ||
+            (opt_.slow_call_ms > 0 && sum.slow >= opt_.slow_rate_threshold * sum.calls))
+            trip(now);
+    }
+
+    void abandon(uint64_t round) {
+        if (!round) return;
+        std::lock_guard<std::mutex> lk(mu_);
+        if (round == round_) probes_in_flight_ = std::max(0, probes_in_flight_ - 1);
+    }
+
+    State state() {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (state_ == State::Open && Clock::now() >= opened_at_ + std::chrono::milliseconds(opt_.open_ms))
+            return State::HalfOpen;
+        return state_;
+    }
+
+private:
+    struct Bucket {
+        Clock::time_point start{};
+        size_t calls = 0;
+        size_t failures = 0;
+        size_t slow = 0;
+    };
+    static constexpr size_t kBuckets = 10;
+
+    // Ring of kBuckets slices covering window_ms; stale slices are recycled
+    Bucket& bucket_at(Clock::time_point now) {
+        const auto width = std::chrono::milliseconds(std::max(1L, opt_.window_ms / static_cast<long>(kBuckets)));
+        const auto slice = now.time_since_epoch() / width;
+        Bucket& b = buckets_[static_cast<size_t>(slice) % kBuckets];
+        const auto start = Clock::time_point(slice * width);
+        if (b.start != start) b = Bucket{start};
+        return b;
+    }
+
+    void trip(Clock::time_point now) {
+        state_ = State::Open;
+        opened_at_ = now;
+        buckets_ = {};
+    }
+
+    const Options& opt_;
+    std::mutex mu_;
+    State state_ = State::Closed;
+    Clock::time_point opened_at_{};
+    uint64_t round_ = 0;        // bumped on every Open -> HalfOpen
+    int probes_in_flight_ = 0;
+    int probes_ok_ = 0;
+    std::array<Bucket, kBuckets> buckets_{};
+};
+
+void CircuitBreaker::Ticket::record(bool success, long latency_ms) {
+    if (host_) std::exchange(host_, nullptr)->record(round_, success, latency_ms);
+}
+
+void CircuitBreaker::Ticket::abandon() {
+    if (host_) std::exchange(host_, nullptr)->abandon(round_);
+}
+
+CircuitBreaker::CircuitBreaker() : CircuitBreaker(Options{}) {}
+
+CircuitBreaker::CircuitBreaker(Options opt) : opt_(opt) {}
+
+CircuitBreaker::~CircuitBreaker() = default;
+
+CircuitBreaker::Host& CircuitBreaker::host_for(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& slot = hosts_[host];
+    if (!slot) slot = std::make_unique<Host>(opt_);
+    return *slot;
+}
+
+std::optional<CircuitBreaker::Ticket> CircuitBreaker::admit(const std::string& host) {
+    Host& h = host_for(host);
+    const auto [ok, round] = h.admit();
+    if (!ok) return std::nullopt;
+    return Ticket(&h, round);
+}
+
+CircuitBreaker::State CircuitBreaker::state(const std::string& host) {
+    return host_for(host).state();
+}
+
+} // namespace net
@@ -0,0 +1,143 @@
+#include "concurrency_limiter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace net {
+
+class ConcurrencyLimiter::Limit {
+public:
+    explicit Limit(const Options& opt) : opt_(opt), limit_(opt.initial_limit) {}
+
+    bool acquire(long wait_ms, const CancellationToken& cancel) {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (in_flight_ < allowed()) {
+                ++in_flight_;
+                return true;
+            }
+            if (wait_ms <= 0 || queued_ >= opt_.max_queued) return false;
+        }
+        // Registered without mu_ held: an already-cancelled token runs the
+        // callback on this thread
+        const uint64_t wake = cancel.add_callback([this]{
+            std::lock_guard<std::mutex> lk(mu_);
+            cv_.notify_all();
+        });
+        bool ok;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            ++queued_;
+            cv_.wait_for(lk, std::chrono::milliseconds(wait_ms),
+                         [&]{ return in_flight_ < allowed() || cancel.cancelled(); });
+            --queued_;
+            ok = in_flight_ < allowed() && !cancel.cancelled();
+            if (ok) ++in_flight_;
+            else if (in_flight_ < allowed()) cv_.notify_one();  // pass the slot on
+        }
+        cancel.remove_callback(wake);
+        return ok;
+    }
+
+    void release(std::optional<long> rtt_us, bool dropped) {
+        std::lock_guard<std::mutex> lk(mu_);
+        const int used = in_flight_--;
+        const int before = allowed();
+        if (dropped) {
+            limit_ = std::max(opt_.min_limit, limit_ * opt_.backoff_ratio);
+        } else if (rtt_us) {
+            if (opt_.algorithm == Algorithm::Aimd) update_aimd(*rtt_us, used);
+            else update_gradient(*rtt_us, used);
+        }
+        if (allowed() > before) cv_.notify_all();
+        else cv_.notify_one();
+    }
+
+    double limit() { std::lock_guard<std::mutex> lk(mu_); return limit_; }
+    int in_flight() { std::lock_guard<std::mutex> lk(mu_); return in_flight_; }
+
+private:
+    int allowed() const { return std::max(1, static_cast<int>(limit_)); }
+
+    void update_aimd(long rtt_us, int used) {
+        if (opt_.latency_threshold_ms > 0 && rtt_us > opt_.latency_threshold_ms * 1000) {
+            limit_ = std::max(opt_.min_limit, limit_ * opt_.backoff_ratio);
+        } else if (used * 2 >= limit_) {
+            // Only grow while the limit is actually the constraint
+            limit_ = std::min(opt_.max_limit, limit_ + 1.0 / limit_);
+        }
+    }
+
+    // Gradient2-style: long_rtt_ is a slow EWMA baseline, the sample is the
+    // short-term RTT; their ratio estimates how much queueing we cause
+    void update_gradient(long rtt_us, int used) {
+        const double rtt = static_cast<double>(std::max(1L, rtt_us));
+        if (long_rtt_ <= 0) long_rtt_ = rtt;
+        else long_rtt_ = long_rtt_ * 0.95 + rtt * 0.05;
+        // Let the baseline recover quickly after a latency spike ends
+        if (long_rtt_ / rtt > 2.0) long_rtt_ *= 0.95;
+
+        if (used * 2 < limit_) return;
+
+        const double gradient = std::clamp(opt_.rtt_tolerance * long_rtt_ / rtt, 0.5, 1.0);
+        const double queue = std::sqrt(limit_);
+        const double estimate = limit_ * gradient + queue;
+        limit_ = std::clamp(limit_ * (1 - opt_.smoothing) + estimate * opt_.smoothing,
+                            opt_.min_limit, opt_.max_limit);
+    }
+
+    const Options& opt_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    double limit_;
+    double long_rtt_ = 0;
+    int in_flight_ = 0;
+    size_t queued_ = 0;
+};
+
+void ConcurrencyLimiter::Permit::success(long rtt_us) {
+    if (limit_) std::exchange(limit_, nullptr)->release(rtt_us, false);
+}
+
+void ConcurrencyLimiter::Permit::dropped() {
+    if (limit_) std::exchange(limit_, nullptr)->release(std::nullopt, true);
+}
+
+void ConcurrencyLimiter::Permit::ignore() {
+    if (limit_) std::exchange(limit_, nullptr)->release(std::nullopt, false);
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter() : ConcurrencyLimiter(Options{}) {}
+
+ConcurrencyLimiter::ConcurrencyLimiter(Options opt) : opt_(opt) {}
+
+ConcurrencyLimiter::~ConcurrencyLimiter() = default;
+
+ConcurrencyLimiter::Limit& ConcurrencyLimiter::limit_for(const std::string& upstream) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& slot = limits_[upstream];
+    if (!slot) slot = std::make_unique<Limit>(opt_);
+    return *slot;
+}
+
+std::optional<ConcurrencyLimiter::Permit> ConcurrencyLimiter::acquire(const std::string& upstream, long max_wait_ms,
+                                                                       const CancellationToken& cancel) {
+    Limit& l = limit_for(upstream);
+    if (!l.acquire(std::min(max_wait_ms, opt_.max_queue_wait_ms), cancel)) return std::nullopt;
+    return Permit(&l);
+}
+
+std::optional<ConcurrencyLimiter::Permit> ConcurrencyLimiter::acquire(const std::string& upstream) {
+    return acquire(upstream, opt_.max_queue_wait_ms, CancellationToken());
+}
+
+std::optional<ConcurrencyLimiter::Permit> ConcurrencyLimiter::try_acquire(const std::string& upstream) {
+    return acquire(upstream, 0, CancellationToken());
+}
+
+double ConcurrencyLimiter::limit(const std::string& upstream) { return limit_for(upstream).limit(); }
+
+int ConcurrencyLimiter::in_flight(const std::string& upstream) { return limit_for(upstream).in_flight(); }
+
+} // namespace net
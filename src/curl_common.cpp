@@ -0,0 +1,172 @@
+#include "curl_common.hpp"
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+
+namespace net::detail {
+
+static std::once_flag g_curl_once;
+
+void global_init_once() {
+    std::call_once(g_curl_once, []{
+        if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0)
+            throw HttpError("curl_global_init failed");
+    });
+}
+
+void apply_transfer_options(CURL* h, const HttpClient::Options& opt) {
+    // Timeout / redirects / user-agent
+    curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, opt.timeout_ms);
+    if (opt.connect_timeout_ms > 0) curl_easy_setopt(h, CURLOPT_CONNECTTIMEOUT_MS, opt.connect_timeout_ms);
+    if (opt.low_speed_limit_bps > 0 && opt.low_speed_time_s > 0) {
+        curl_easy_setopt(h, CURLOPT_LOW_SPEED_LIMIT, opt.low_speed_limit_bps);
+        curl_easy_setopt(h, CURLOPT_LOW_SPEED_TIME, opt.low_speed_time_s);
+    }
+    if (opt.max_recv_bps > 0) curl_easy_setopt(h, CURLOPT_MAX_RECV_SPEED_LARGE, static_cast<curl_off_t>(opt.max_recv_bps));
+    if (opt.max_send_bps > 0) curl_easy_setopt(h, CURLOPT_MAX_SEND_SPEED_LARGE, static_cast<curl_off_t>(opt.max_send_bps));
+    curl_easy_setopt(h, CURLOPT_FOLLOWLOCATION, opt.follow_redirects ? 1L : 0L);
+    // Timeouts must not use SIGALRM: transfers run on many threads
+    curl_easy_setopt(h, CURLOPT_NOSIGNAL, 1L);
+    if (opt.user_agent && !opt.user_agent->empty())
+        curl_easy_setopt(h, CURLOPT_USERAGENT, opt.user_agent->c_str());
+
+    // TLS verification
+    curl_easy_setopt(h, CURLOPT_SSL_VERIFYPEER, opt.verify_peer ? 1L : 0L);
+    curl_easy_setopt(h, CURLOPT_SSL_VERIFYHOST, opt.verify_host ? 2L : 0L);
+
+    // Local transport; the URL still supplies the scheme, Host header and path
+    if (!opt.unix_socket_path.empty()) {
+        curl_easy_setopt(h, opt.abstract_unix_socket ? CURLOPT_ABSTRACT_UNIX_SOCKET : CURLOPT_UNIX_SOCKET_PATH,
+                         opt.unix_socket_path.c_str());
+    }
+
+    // Connection reuse and TCP
+    if (opt.max_idle_s > 0) curl_easy_setopt(h, CURLOPT_MAXAGE_CONN, opt.max_idle_s);
+#if LIBCURL_VERSION_NUM >= 0x075000
+    if (opt.max_connection_age_s > 0) curl_easy_setopt(h, CURLOPT_MAXLIFETIME_CONN, opt.max_connection_age_s);
+#endif
+    if (!opt.reuse_connections) curl_easy_setopt(h, CURLOPT_FORBID_REUSE, 1L);
+    curl_easy_setopt(h, CURLOPT_TCP_NODELAY, opt.tcp_nodelay ? 1L : 0L);
+    if (opt.tcp_keepalive) {
+        curl_easy_setopt(h, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(h, CURLOPT_TCP_KEEPIDLE, opt.tcp_keepidle_s);
+        curl_easy_setopt(h, CURLOPT_TCP_KEEPINTVL, opt.tcp_keepintvl_s);
+    }
+}
+
+void apply_pool_options(CURLM* m, const HttpClient::Options& opt) {
+    if (opt.max_connections > 0) curl_multi_setopt(m, CURLMOPT_MAX_TOTAL_CONNECTIONS, opt.max_connections);
+    if (opt.max_host_connections > 0) curl_multi_setopt(m, CURLMOPT_MAX_HOST_CONNECTIONS, opt.max_host_connections);
+    if (opt.max_idle_connections > 0) curl_multi_setopt(m, CURLMOPT_MAXCONNECTS, opt.max_idle_connections);
+}
+
+static inline std::pair<std::string,std::string> split_header_line(const std::string& line) {
+    auto pos = line.find(':');
+    if (pos == std::string::npos) return {line, ""};
+    // Trim spaces after ':'
+    size_t start = pos + 1;
+    while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) ++start;
+    return { line.substr(0, pos), line.substr(start) };
+}
+
+void append_header_line(HeaderList& headers, const char* buffer, size_t len) {
+    // Each header line comes with \r\n
+    std::string line(buffer, len);
+    if (line.rfind("HTTP/", 0) == 0) {
+        // New status section — clear accumulated headers (redirects / multi-stage responses)
+        headers.clear();
+    } else if (!line.empty() && line != "\r\n") {
+        headers.push_back(split_header_line(line.substr(0, line.find("\r\n"))));
+    }
+}
+
+static size_t transfer_body_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto t = static_cast<AsyncTransfer*>(userdata);
+    t->body.append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+static size_t transfer_header_cb(char* buffer, size_t size, size_t nitems, void* userdata) {
+    auto t = static_cast<AsyncTransfer*>(userdata);
+    const size_t total = size * nitems;
+    t->first_byte_by.reset();
+    append_header_line(t->headers, buffer, total);
+    return total;
+}
+
+void prepare_transfer(AsyncTransfer& t, const HttpClient::Options& opt) {
+    if (t.cancelled()) throw CancelledError("request cancelled");
+    long timeout = opt.timeout_ms;
+    if (t.req.ro.deadline) {
+        const auto now = RequestOptions::Clock::now();
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(*t.req.ro.deadline - now).count();
+        if (remaining <= 0) throw HttpError("deadline exceeded");
+        timeout = timeout > 0 ? std::min<long>(timeout, remaining) : static_cast<long>(remaining);
+    }
+
+    if (opt.first_byte_timeout_ms > 0)
+        t.first_byte_by = std::chrono::steady_clock::now() + std::chrono::milliseconds(opt.first_byte_timeout_ms);
+
+    t.h = curl_easy_init();
+    if (!t.h) throw HttpError("curl_easy_init failed");
+    CURL* h = t.h;
+    apply_transfer_options(h, opt);
+    curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, timeout);
+    if (t.req.ro.max_recv_bps > 0)
+        curl_easy_setopt(h, CURLOPT_MAX_RECV_SPEED_LARGE, static_cast<curl_off_t>(t.req.ro.max_recv_bps));
+    if (t.req.ro.max_send_bps > 0)
+        curl_easy_setopt(h, CURLOPT_MAX_SEND_SPEED_LARGE, static_cast<curl_off_t>(t.req.ro.max_send_bps));
+    curl_easy_setopt(h, CURLOPT_URL, t.req.url.c_str());
+    curl_easy_setopt(h, CURLOPT_PRIVATE, &t);
+    curl_easy_setopt(h, CURLOPT_WRITEFUNCTION, &transfer_body_cb);
+    curl_easy_setopt(h, CURLOPT_WRITEDATA, &t);
+    curl_easy_setopt(h, CURLOPT_HEADERFUNCTION, &transfer_header_cb);
+    curl_easy_setopt(h, CURLOPT_HEADERDATA, &t);
+
+    if (t.req.method == "POST") {
+        curl_easy_setopt(h, CURLOPT_POST, 1L);
+        curl_easy_setopt(h, CURLOPT_POSTFIELDS, t.req.body.c_str());
+        curl_easy_setopt(h, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(t.req.body.size()));
+    } else if (t.req.method != "GET") {
+        curl_easy_setopt(h, CURLOPT_CUSTOMREQUEST, t.req.method.c_str());
+    }
+
+    for (const auto& kv : t.req.headers) {
+        const std::string line = kv.first + ": " + kv.second;
+        curl_slist* next = curl_slist_append(t.slist.get(), line.c_str());
+        if (!next) throw HttpError("curl_slist_append failed");
+        t.slist.release();
+        t.slist.reset(next);
+    }
+    if (t.slist) curl_easy_setopt(h, CURLOPT_HTTPHEADER, t.slist.get());
+}
+
+AsyncResult transfer_result(AsyncTransfer& t, CURLcode res) {
+    AsyncResult r;
+    if (res != CURLE_OK) {
+        if (t.cancelled()) {
+            r.error = std::make_exception_ptr(CancelledError("request cancelled"));
+        } else {
+            std::ostringstream oss;
+            oss << "curl_easy_perform failed: " << curl_easy_strerror(res);
+            r.error = std::make_exception_ptr(HttpError(oss.str()));
+        }
+        return r;
+    }
+    long code = 0;
+    curl_easy_getinfo(t.h, CURLINFO_RESPONSE_CODE, &code);
+    r.response.status = code;
+    r.response.body = std::move(t.body);
+    r.response.headers = std::move(t.headers);
+    return r;
+}
+
+void deliver(std::function<void(AsyncResult)> done, AsyncResult r) {
+    try {
+        if (done) done(std::move(r));
+    } catch (...) {
+        // A throwing completion must not take down the event loop
+    }
+}
+
+} // namespace net::detail
@@ -0,0 +1,66 @@
+#pragma once
+// Internal helpers shared by HttpClient and AsyncHttpClient
+#include "async_http_client.hpp"
+#include "http_client.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace net::detail {
+
+// Thread-safe global initialization of libcurl
+void global_init_once();
+
+// Transfer settings from Options: timeouts, low-speed abort, redirects,
+// user-agent, TLS verification, transport and per-connection reuse and TCP
+// settings. Callbacks are left to the caller.
+void apply_transfer_options(CURL* h, const HttpClient::Options& opt);
+
+// Connection-pool limits from Options for a multi handle
+void apply_pool_options(CURLM* m, const HttpClient::Options& opt);
+
+// Feeds one CURLOPT_HEADERFUNCTION line into headers; a status line starts a
+// new header block (redirects / 1xx responses)
+void append_header_line(HeaderList& headers, const char* buffer, size_t len);
+
+// One request in flight on a multi handle: the easy handle, its header list
+// and what the callbacks have accumulated. Shared by the async engines.
+struct AsyncTransfer {
+    AsyncRequest req;
+    std::function<void(AsyncResult)> done;
+    CURL* h = nullptr;
+    std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> slist{nullptr, &curl_slist_free_all};
+    std::string body;
+    HeaderList headers;
+    // Set by prepare_transfer when Options::first_byte_timeout_ms is on;
+    // cleared by the first response header. The engine aborts the transfer
+    // once it passes.
+    std::optional<std::chrono::steady_clock::time_point> first_byte_by;
+
+    AsyncTransfer() = default;
+    AsyncTransfer(const AsyncTransfer&) = delete;
+    AsyncTransfer& operator=(const AsyncTransfer&) = delete;
+    ~AsyncTransfer() { if (h) curl_easy_cleanup(h); }
+
+    bool cancelled() const { return req.ro.cancel.cancelled(); }
+    bool expired(RequestOptions::Clock::time_point now) const {
+        return req.ro.deadline && *req.ro.deadline <= now;
+    }
+    bool first_byte_overdue(std::chrono::steady_clock::time_point now) const {
+        return first_byte_by && *first_byte_by <= now;
+    }
+};
+
+// Creates and configures t.h for t.req (CURLOPT_PRIVATE = &t), clamping the
+// timeout to the request deadline and arming first_byte_by. Throws
+// CancelledError / HttpError.
+void prepare_transfer(AsyncTransfer& t, const HttpClient::Options& opt);
+
+// Outcome of a transfer that curl reported done with res
+AsyncResult transfer_result(AsyncTransfer& t, CURLcode res);
+
+// Runs done, swallowing exceptions so a callback can't take down the event loop
+void deliver(std::function<void(AsyncResult)> done, AsyncResult r);
+
+} // namespace net::detail
@@ -0,0 +1,381 @@
+#include "disk_cache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x31524348;  // "HCR1"
+constexpr uint32_t kTombstone = 1u << 0;
+constexpr uint32_t kMetaOnly = 1u << 1;   // body lives in an earlier record for the same key
+constexpr size_t kHeaderSize = 32;
+
+// magic, flags, key_len, meta_len, body_len (u64), checksum, reserved
+struct RecordHeader {
+    uint32_t magic = kMagic;
+    uint32_t flags = 0;
+    uint32_t key_len = 0;
+    uint32_t meta_len = 0;
+    uint64_t body_len = 0;
+    uint32_t checksum = 0;
+};
+
+uint32_t fnv1a(uint32_t h, const void* data, size_t n) {
+    auto p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+// Covers the header fields and key + meta; bodies are not hashed so opening a
+// large cache does not touch every page
+uint32_t record_checksum(const RecordHeader& h, std::string_view key, std::string_view meta) {
+    uint32_t c = 2166136261u;
+    c = fnv1a(c, &h.flags, sizeof h.flags);
+    c = fnv1a(c, &h.key_len, sizeof h.key_len);
+    c = fnv1a(c, &h.meta_len, sizeof h.meta_len);
+    c = fnv1a(c, &h.body_len, sizeof h.body_len);
+    c = fnv1a(c, key.data(), key.size());
+    c = fnv1a(c, meta.data(), meta.size());
+    return c;
+}
+
+void encode_header(const RecordHeader& h, char* out) {
+    std::memcpy(out + 0, &h.magic, 4);
+    std::memcpy(out + 4, &h.flags, 4);
+    std::memcpy(out + 8, &h.key_len, 4);
+    std::memcpy(out + 12, &h.meta_len, 4);
+    std::memcpy(out + 16, &h.body_len, 8);
+    std::memcpy(out + 24, &h.checksum, 4);
+    std::memset(out + 28, 0, 4);
+}
+
+RecordHeader decode_header(const char* in) {
+    RecordHeader h;
+    std::memcpy(&h.magic, in + 0, 4);
+    std::memcpy(&h.flags, in + 4, 4);
+    std::memcpy(&h.key_len, in + 8, 4);
+    std::memcpy(&h.meta_len, in + 12, 4);
+    std::memcpy(&h.body_len, in + 16, 8);
+    std::memcpy(&h.checksum, in + 24, 4);
+    return h;
+}
+
+} // namespace
+
+// Read-only mapping of the first `size` bytes of the cache file
+class DiskCache::Mapping {
+public:
+    Mapping(const std::string& path, uint64_t size) {
+        if (size == 0) return;
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        map_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, static_cast<DWORD>(size >> 32),
+                                  static_cast<DWORD>(size), nullptr);
+        if (!map_) return;
+        data_ = static_cast<const char*>(MapViewOfFile(map_, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(size)));
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return;
+        data_ = static_cast<const char*>(p);
+#endif
+        if (data_) size_ = size;
+    }
+
+    ~Mapping() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (map_) CloseHandle(map_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    const char* data() const { return data_; }
+    uint64_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    uint64_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE map_ = nullptr;
+#endif
+};
+
+DiskCache::DiskCache(Options opt) : opt_(std::move(opt)) {
+    std::lock_guard<std::mutex> lk(mu_);
+    load_index_locked();
+    if (size_ > opt_.max_bytes || size_ > 2 * live_bytes_ + (uint64_t(1) << 20)) compact_locked();
+    if (!file_) open_locked();
+}
+
+DiskCache::~DiskCache() {
+    if (file_) std::fclose(file_);
+}
+
+void DiskCache::open_locked() {
+    file_ = std::fopen(opt_.path.c_str(), "ab");
+}
+
+void DiskCache::load_index_locked() {
+    std::error_code ec;
+    const uint64_t size = std::filesystem::exists(opt_.path, ec) ? std::filesystem::file_size(opt_.path, ec) : 0;
+    if (ec || size == 0) return;
+
+    const Mapping m(opt_.path, size);
+    if (!m.data()) return;
+
+    uint64_t pos = 0;
+    while (pos + kHeaderSize <= m.size()) {
+        const RecordHeader h = decode_header(m.data() + pos);
+        const uint64_t end = pos + kHeaderSize + h.key_len + h.meta_len + h.body_len;
+        if (h.magic != kMagic || end > m.size()) break;
+        const std::string_view key(m.data() + pos + kHeaderSize, h.key_len);
+        const std::string_view meta(key.data() + key.size(), h.meta_len);
+        if (record_checksum(h, key, meta) != h.checksum) break;
+
+        const std::string k(key);
+        auto it = index_.find(k);
+        if (h.flags & kTombstone) {
+            drop_locked(k);
+        } else if (h.flags & kMetaOnly) {
+            if (it != index_.end()) {
+                it->second.meta_off = pos + kHeaderSize + h.key_len;
+                it->second.meta_len = h.meta_len;
+                it->second.record_bytes += end - pos;
+                live_bytes_ += end - pos;
+            }
+        } else {
+            if (it != index_.end()) live_bytes_ -= it->second.record_bytes;
+            Location loc;
+            loc.meta_off = pos + kHeaderSize + h.key_len;
+            loc.meta_len = h.meta_len;
+            loc.body_off = loc.meta_off + h.meta_len;
+            loc.body_len = h.body_len;
+            loc.record_bytes = end - pos;
+            index_[k] = loc;
+            live_bytes_ += loc.record_bytes;
+        }
+        pos = end;
+    }
+    size_ = pos;
+
+    // Drop a torn or corrupt tail left by a crash mid-append
+    if (pos < size) std::filesystem::resize_file(opt_.path, pos, ec);
+}
+
+std::shared_ptr<const DiskCache::Mapping> DiskCache::mapping_for_locked(uint64_t end) {
+    if (!mapping_ || mapping_->size() < end) {
+        if (file_) std::fflush(file_);
+        auto m = std::make_shared<const Mapping>(opt_.path, size_);
+        if (!m->data()) return nullptr;
+        mapping_ = std::move(m);
+    }
+    return mapping_;
+}
+
+std::optional<DiskCache::Hit> DiskCache::lookup(const std::string& key) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = index_.find(key);
+    if (it == index_.end()) return std::nullopt;
+    const Location& loc = it->second;
+    auto m = mapping_for_locked(std::max(loc.meta_off + loc.meta_len, loc.body_off + loc.body_len));
+    if (!m) return std::nullopt;
+
+    Hit hit;
+    hit.meta = std::string_view(m->data() + loc.meta_off, loc.meta_len);
+    hit.body = std::string_view(m->data() + loc.body_off, loc.body_len);
+    hit.mapping = std::move(m);
+    return hit;
+}
+
+void DiskCache::append_locked(const std::string& key, std::string_view meta, std::string_view body,
+                              uint32_t flags, const Location* reuse_body) {
+    // A refused write must still invalidate the key, or the previous record
+    // would keep being served. Over budget with compaction failing, only
+    // tombstones (tiny, and each one shrinks the index) are still written, so
+    // a reopen does not bring the old record back either.
+    if (!file_) {
+        drop_locked(key);
+        return;
+    }
+    if (compact_failed_ && size_ > opt_.max_bytes && !(flags & kTombstone)) {
+        if (index_.count(key)) append_locked(key, {}, {}, kTombstone, nullptr);
+        return;
+    }
+    RecordHeader h;
+    h.flags = flags;
+    h.key_len = static_cast<uint32_t>(key.size());
+    h.meta_len = static_cast<uint32_t>(meta.size());
+    h.body_len = body.size();
+    h.checksum = record_checksum(h, key, meta);
+
+    char hdr[kHeaderSize];
+    encode_header(h, hdr);
+    const uint64_t pos = size_;
+    const bool ok = std::fwrite(hdr, 1, kHeaderSize, file_) == kHeaderSize &&
+                    std::fwrite(key.data(), 1, key.size(), file_) == key.size() &&
+                    std::fwrite(meta.data(), 1, meta.size(), file_) == meta.size() &&
+                    std::fwrite(body.data(), 1, body.size(), file_) == body.size();
+    const uint64_t record = kHeaderSize + key.size() + meta.size() + body.size();
+    if (!ok) {
+        // Leave the partial record for load_index_locked() to truncate; stop writing
+        std::fclose(file_);
+        file_ = nullptr;
+        drop_locked(key);
+        return;
+    }
+    size_ = pos + record;
+
+    if (flags & kTombstone) {
+        drop_locked(key);
+        return;
+    }
+    auto it = index_.find(key);
+    Location loc;
+    loc.meta_off = pos + kHeaderSize + key.size();
+    loc.meta_len = h.meta_len;
+    if (reuse_body) {
+        loc.body_off = reuse_body->body_off;
+        loc.body_len = reuse_body->body_len;
+        loc.record_bytes = reuse_body->record_bytes + record;
+    } else {
+        loc.body_off = loc.meta_off + meta.size();
+        loc.body_len = body.size();
+        loc.record_bytes = record;
+    }
+    if (it != index_.end()) live_bytes_ -= it->second.record_bytes;
+    live_bytes_ += loc.record_bytes;
+    index_[key] = loc;
+}
+
+void DiskCache::drop_locked(const std::string& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return;
+    live_bytes_ -= it->second.record_bytes;
+    index_.erase(it);
+}
+
+void DiskCache::put(const std::string& key, std::string_view meta, std::string_view body) {
+    std::lock_guard<std::mutex> lk(mu_);
+    append_locked(key, meta, body, 0, nullptr);
+    if (size_ > opt_.max_bytes && !compact_failed_) compact_locked();
+}
+
+bool DiskCache::update_meta(const std::string& key, std::string_view meta) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = index_.find(key);
+    if (it == index_.end()) return false;
+    const Location old = it->second;
+    append_locked(key, meta, {}, kMetaOnly, &old);
+    if (size_ > opt_.max_bytes && !compact_failed_) compact_locked();
+    return index_.count(key) > 0;  // false if the update was refused
+}
+
+void DiskCache::erase(const std::string& key) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (index_.count(key)) append_locked(key, {}, {}, kTombstone, nullptr);
+}
+
+void DiskCache::compact_locked() {
+    auto m = mapping_for_locked(size_);
+    if (size_ > 0 && !m) return;
+
+    // Keep the newest records that fit in half the budget, so compaction is
+    // not immediately triggered again; older ones are dropped
+    std::vector<std::pair<const std::string*, const Location*>> keep;
+    keep.reserve(index_.size());
+    for (auto& [k, loc] : index_) keep.emplace_back(&k, &loc);
+    std::sort(keep.begin(), keep.end(), [](auto& a, auto& b){ return a.second->meta_off > b.second->meta_off; });
+    uint64_t budget = 0;
+    size_t n = 0;
+    for (; n < keep.size(); ++n) {
+        budget += kHeaderSize + keep[n].first->size() + keep[n].second->meta_len + keep[n].second->body_len;
+        if (budget > opt_.max_bytes / 2 && n > 0) break;
+    }
+    keep.resize(n);
+
+    const std::string tmp = opt_.path + ".compact";
+    std::FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) {
+        compact_failed_ = true;
+        return;
+    }
+
+    std::unordered_map<std::string, Location> fresh;
+    uint64_t pos = 0;
+    bool ok = true;
+    for (auto it = keep.rbegin(); it != keep.rend() && ok; ++it) {
+        const auto& [key, loc] = *it;
+        const std::string_view meta(m->data() + loc->meta_off, loc->meta_len);
+        const std::string_view body(m->data() + loc->body_off, loc->body_len);
+        RecordHeader h;
+        h.key_len = static_cast<uint32_t>(key->size());
+        h.meta_len = loc->meta_len;
+        h.body_len = loc->body_len;
+        h.checksum = record_checksum(h, *key, meta);
+        char hdr[kHeaderSize];
+        encode_header(h, hdr);
+        ok = std::fwrite(hdr, 1, kHeaderSize, out) == kHeaderSize &&
+             std::fwrite(key->data(), 1, key->size(), out) == key->size() &&
+             std::fwrite(meta.data(), 1, meta.size(), out) == meta.size() &&
+             std::fwrite(body.data(), 1, body.size(), out) == body.size();
+
+        Location nl;
+        nl.meta_off = pos + kHeaderSize + key->size();
+        nl.meta_len = loc->meta_len;
+        nl.body_off = nl.meta_off + loc->meta_len;
+        nl.body_len = loc->body_len;
+        nl.record_bytes = kHeaderSize + key->size() + loc->meta_len + loc->body_len;
+        pos += nl.record_bytes;
+        fresh.emplace(*key, nl);
+    }
+    ok = std::fclose(out) == 0 && ok;
+
+    std::error_code ec;
+    if (file_) { std::fclose(file_); file_ = nullptr; }
+    if (ok) std::filesystem::rename(tmp, opt_.path, ec);
+    if (!ok || ec) {
+        // Keep the old file (e.g. it is still mapped on Windows) and stop
+        // growing it; compaction is retried on the next open
+        std::filesystem::remove(tmp, ec);
+        compact_failed_ = true;
+    } else {
+        index_ = std::move(fresh);
+        size_ = live_bytes_ = pos;
+        mapping_.reset();  // outstanding Hits keep the old mapping alive
+    }
+    open_locked();
+}
+
+uint64_t DiskCache::file_bytes() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return size_;
+}
+
+size_t DiskCache::entries() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return index_.size();
+}
+
+} // namespace net
@@ -0,0 +1,182 @@
+#include "dns_cache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+namespace net {
+
+namespace {
+
+bool is_ip_literal(const std::string& host) {
+    unsigned char buf[16];
+    return inet_pton(AF_INET, host.c_str(), buf) == 1 || inet_pton(AF_INET6, host.c_str(), buf) == 1;
+}
+
+// Comma-separated addresses in the resolver's preference order, IPv6 in
+// brackets as CURLOPT_RESOLVE expects; empty on failure
+std::string resolve_addresses(const std::string& host) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) return {};
+
+    std::vector<std::string> seen;
+    std::string out;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        char text[INET6_ADDRSTRLEN] = {0};
+        std::string addr;
+        if (ai->ai_family == AF_INET) {
+            inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(ai->ai_addr)->sin_addr, text, sizeof text);
+            addr = text;
+        } else if (ai->ai_family == AF_INET6) {
+            inet_ntop(AF_INET6, &reinterpret_cast<sockaddr_in6*>(ai->ai_addr)->sin6_addr, text, sizeof text);
+            addr = std::string("[") + text + "]";
+        } else {
+            continue;
+        }
+        if (std::find(seen.begin(), seen.end(), addr) != seen.end()) continue;
+        seen.push_back(addr);
+        if (!out.empty()) out += ',';
+        out += addr;
+    }
+    freeaddrinfo(res);
+    return out;
+}
+
+} // namespace
+
+DnsCache::DnsCache() : DnsCache(Options{}) {}
+
+DnsCache::DnsCache(Options opt) : opt_(std::move(opt)) {
+    worker_ = std::thread([this]{ run(); });
+}
+
+DnsCache::~DnsCache() {
+    {
+        std::lock_guard<std::mutex> lk(queue_mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+std::string DnsCache::key_of(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+std::optional<DnsCache::Pin> DnsCache::lookup(const std::string& host, int port) {
+    if (host.empty() || is_ip_literal(host)) return std::nullopt;
+    const auto key = key_of(host, port);
+    const auto now = Clock::now();
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            Entry& e = *it->second;
+            e.last_used.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+            e.used.store(true, std::memory_order_relaxed);
+            if (now < e.serve_until) return e.pin;
+        }
+    }
+    schedule(host, port);
+    return std::nullopt;
+}
+
+void DnsCache::prefetch(const std::string& host, int port) {
+    if (host.empty() || is_ip_literal(host)) return;
+    schedule(host, port);
+}
+
+size_t DnsCache::size() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    return entries_.size();
+}
+
+void DnsCache::schedule(const std::string& host, int port) {
+    {
+        std::lock_guard<std::mutex> lk(queue_mu_);
+        if (!pending_.emplace(key_of(host, port), std::make_pair(host, port)).second) return;
+    }
+    cv_.notify_one();
+}
+
+void DnsCache::run() {
+    const auto ttl = std::chrono::milliseconds(opt_.ttl_ms);
+    const auto refresh_at = std::chrono::milliseconds(static_cast<long>(opt_.ttl_ms * opt_.refresh_ahead));
+    // Wake often enough to catch every entry between refresh_at and expiry
+    const auto tick = std::max(std::chrono::milliseconds(100), (ttl - refresh_at) / 2);
+
+    std::unique_lock<std::mutex> qlk(queue_mu_);
+    while (!stop_) {
+        cv_.wait_for(qlk, tick, [this]{ return stop_ || !pending_.empty(); });
+        if (stop_) break;
+        auto work = std::move(pending_);
+        pending_.clear();
+        qlk.unlock();
+
+        // Add hot entries that are due for a refresh, drop idle ones
+        const auto now = Clock::now();
+        {
+            std::unique_lock<std::shared_mutex> lk(mu_);
+            for (auto it = entries_.begin(); it != entries_.end();) {
+                Entry& e = *it->second;
+                const auto last_used = Clock::time_point(Clock::duration(e.last_used.load(std::memory_order_relaxed)));
+                if (now - last_used > std::chrono::milliseconds(opt_.idle_evict_ms) && now >= e.serve_until) {
+                    it = entries_.erase(it);
+                    continue;
+                }
+                if (e.used.load(std::memory_order_relaxed) && now >= e.next_refresh)
+                    work.emplace(it->first, std::make_pair(e.host, e.port));
+                ++it;
+            }
+        }
+
+        // getaddrinfo runs without any lock held
+        for (auto& [key, hp] : work) {
+            const std::string addrs = resolve_addresses(hp.first);
+            const auto done = Clock::now();
+            std::unique_lock<std::shared_mutex> lk(mu_);
+            auto it = entries_.find(key);
+            if (addrs.empty()) {
+                // Keep serving the last good answer for a while
+                if (it != entries_.end()) {
+                    Entry& e = *it->second;
+                    e.serve_until = std::max(e.serve_until, e.resolved_at + ttl + std::chrono::milliseconds(opt_.stale_ms));
+                    e.next_refresh = done + (ttl - refresh_at);  // retry later, not every tick
+                    e.used.store(false, std::memory_order_relaxed);
+                }
+                continue;
+            }
+            if (it == entries_.end()) {
+                if (entries_.size() >= opt_.max_hosts) continue;
+                auto e = std::make_unique<Entry>();
+                e->host = hp.first;
+                e->port = hp.second;
+                e->last_used.store(done.time_since_epoch().count(), std::memory_order_relaxed);
+                it = entries_.emplace(key, std::move(e)).first;
+            }
+            Entry& e = *it->second;
+            const std::string line = key + ":" + addrs;
+            if (line != e.pin.resolve) {
+                e.pin.resolve = line;
+                e.pin.generation = ++next_generation_;
+            }
+            e.resolved_at = done;
+            e.next_refresh = done + refresh_at;
+            e.serve_until = done + ttl;
+            e.used.store(false, std::memory_order_relaxed);
+        }
+        qlk.lock();
+    }
+}
+
+} // namespace net
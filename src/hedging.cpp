@@ -0,0 +1,38 @@
+#include "hedging.hpp"
+#include <algorithm>
+
+namespace net {
+
+LatencyTracker::LatencyTracker(size_t capacity) : ring_(std::max<size_t>(1, capacity)) {}
+
+void LatencyTracker::record(long latency_ms) {
+    std::lock_guard<std::mutex> lk(mu_);
+    ring_[next_] = latency_ms;
+    next_ = (next_ + 1) % ring_.size();
+    if (count_ < ring_.size()) ++count_;
+}
+
+size_t LatencyTracker::samples() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return count_;
+}
+
+long LatencyTracker::percentile(double p) const {
+    std::vector<long> snap;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (count_ == 0) return -1;
+        snap.assign(ring_.begin(), ring_.begin() + count_);
+    }
+    p = std::clamp(p, 0.0, 1.0);
+    const auto idx = static_cast<size_t>(p * (snap.size() - 1));
+    std::nth_element(snap.begin(), snap.begin() + idx, snap.end());
+    return snap[idx];
+}
+
+long HedgePolicy::delay_ms(const LatencyTracker& tracker) const {
+    const long d = tracker.samples() < min_samples ? fixed_delay_ms : tracker.percentile(percentile);
+    return std::max(min_delay_ms, d);
+}
+
+} // namespace net
@@ -1,150 +1,685 @@
-#include "http_client.hpp"
-#include <sstream>
-#include <cstring>
-
-namespace net {
-
-static std::once_flag g_curl_once;
-
-void HttpClient::global_init_once() {
-    std::call_once(g_curl_once, []{
-        if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0)
-            throw HttpError("curl_global_init failed");
-    });
-}
-
-HttpClient::HttpClient(Options opt) : opt_(std::move(opt)) {
-    global_init_once();
-    h_ = curl_easy_init();
-    if (!h_) throw HttpError("curl_easy_init failed");
-    apply_common_options();
-}
-
-HttpClient::HttpClient() : HttpClient(Options{}) {}
-
-HttpClient::~HttpClient() {
-    if (h_) curl_easy_cleanup(h_);
-}
-
-HttpClient::HttpClient(HttpClient&& other) noexcept : h_(other.h_), opt_(other.opt_) {
-    other.h_ = nullptr;
-}
-
-HttpClient& HttpClient::operator=(HttpClient&& other) noexcept {
-    if (this != &other) {
-        if (h_) curl_easy_cleanup(h_);
-        h_ = other.h_;
-        opt_ = other.opt_;
-        other.h_ = nullptr;
-    }
-    return *this;
-}
-
-void HttpClient::set_options(const Options& opt) {
-    opt_ = opt;
-    apply_common_options();
-}
-
-void HttpClient::apply_common_options() {
-    curl_easy_reset(h_);
-    // Basic callbacks
-    curl_easy_setopt(h_, CURLOPT_WRITEFUNCTION, &HttpClient::write_body_cb);
-    curl_easy_setopt(h_, CURLOPT_WRITEDATA, this);
-    curl_easy_setopt(h_, CURLOPT_HEADERFUNCTION, &HttpClient::write_header_cb);
-    curl_easy_setopt(h_, CURLOPT_HEADERDATA, this);
-
-    // Timeout / redirects / user-agent
-    curl_easy_setopt(h_, CURLOPT_TIMEOUT_MS, opt_.timeout_ms);
-    curl_easy_setopt(h_, CURLOPT_FOLLOWLOCATION, opt_.follow_redirects ? 1L : 0L);
-    if (opt_.user_agent && !opt_.user_agent->empty())
-        curl_easy_setopt(h_, CURLOPT_USERAGENT, opt_.user_agent->c_str());
-
-    // TLS verification
-    curl_easy_setopt(h_, CURLOPT_SSL_VERIFYPEER, opt_.verify_peer ? 1L : 0L);
-    curl_easy_setopt(h_, CURLOPT_SSL_VERIFYHOST, opt_.verify_host ? 2L : 0L);
-}
-
-size_t HttpClient::write_body_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto self = static_cast<HttpClient*>(userdata);
-    self->body_acc_.append(ptr, size * nmemb);
-    return size * nmemb;
-}
-
-static inline std::pair<std::string,std::string> split_header_line(const std::string& line) {
-    auto pos = line.find(':');
-    if (pos == std::string::npos) return {line, ""};
-    // Trim spaces after ':'
-    size_t start = pos + 1;
-    while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) ++start;
-    return { line.substr(0, pos), line.substr(start) };
-}
-
-size_t HttpClient::write_header_cb(char* buffer, size_t size, size_t nitems, void* userdata) {
-    auto self = static_cast<HttpClient*>(userdata);
-    const size_t total = size * nitems;
-    // Each header line comes with \r\n
-    std::string line(buffer, total);
-    if (line.rfind("HTTP/", 0) == 0) {
-        // New status section — clear accumulated headers (redirects / multi-stage responses)
-        self->hdr_acc_.clear();
-    } else if (!line.empty() && line != "\r\n") {
-        auto kv = split_header_line(line.substr(0, line.find("\r\n")));
-        self->hdr_acc_.push_back(std::move(kv));
-    }
-    return total;
-}
-
-Response HttpClient::perform_with_headers_and_body() {
-    body_acc_.clear();
-    hdr_acc_.clear();
-
-    const auto res = curl_easy_perform(h_);
-    if (res != CURLE_OK) {
-        std::ostringstream oss;
-        oss << "curl_easy_perform failed: " << curl_easy_strerror(res);
-        throw HttpError(oss.str());
-    }
-    long code = 0;
-    curl_easy_getinfo(h_, CURLINFO_RESPONSE_CODE, &code);
-
-    Response r;
-    r.status = code;
-    r.body = std::move(body_acc_);
-    r.headers = std::move(hdr_acc_);
-    return r;
-}
-
-Response HttpClient::get(const std::string& url,
-                         const std::vector<std::pair<std::string,std::string>>& headers) {
-    apply_common_options();
-    curl_easy_setopt(h_, CURLOPT_HTTPGET, 1L);
-    curl_easy_setopt(h_, CURLOPT_URL, url.c_str());
-
-    Slist sl;
-    for (auto& [k,v] : headers) {
-        sl.add(k + ": " + v);
-    }
-    if (sl.ptr) curl_easy_setopt(h_, CURLOPT_HTTPHEADER, sl.ptr);
-
-    return perform_with_headers_and_body();
-}
-
-Response HttpClient::post(const std::string& url,
-                          std::string_view data,
-                          const std::vector<std::pair<std::string,std::string>>& headers) {
-    apply_common_options();
-    curl_easy_setopt(h_, CURLOPT_POST, 1L);
-    curl_easy_setopt(h_, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(h_, CURLOPT_POSTFIELDS, data.data());
-    curl_easy_setopt(h_, CURLOPT_POSTFIELDSIZE, static_cast<long>(data.size()));
-
-    Slist sl;
-    for (auto& [k,v] : headers) {
-        sl.add(k + ": " + v);
-    }
-    if (sl.ptr) curl_easy_setopt(h_, CURLOPT_HTTPHEADER, sl.ptr);
-
-    return perform_with_headers_and_body();
-}
-
-} // namespace net
+#include "http_client.hpp"
+#include "cache_refresher.hpp"
+#include "curl_common.hpp"
+#include <sstream>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+namespace net {
+
+void HttpClient::global_init_once() {
+    detail::global_init_once();
+}
+
+HttpClient::HttpClient(Options opt) : opt_(std::move(opt)), latency_(std::make_shared<LatencyTracker>()) {
+    global_init_once();
+    share_ = curl_share_init();
+    if (!share_) throw HttpError("curl_share_init failed");
+    // The client is single-threaded, so the share needs no lock callbacks
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    h_ = curl_easy_init();
+    if (!h_) {
+        curl_share_cleanup(share_);
+        throw HttpError("curl_easy_init failed");
+    }
+    apply_common_options();
+    if (opt_.tls_sessions) opt_.tls_sessions->import_into(h_);
+}
+
+HttpClient::HttpClient() : HttpClient(Options{}) {}
+
+HttpClient::~HttpClient() {
+    if (h_ && opt_.tls_sessions) opt_.tls_sessions->export_from(h_);
+    if (multi_) curl_multi_cleanup(multi_);
+    if (h_) curl_easy_cleanup(h_);
+    // Last: the share must outlive every handle attached to it
+    if (share_) curl_share_cleanup(share_);
+}
+
+HttpClient::HttpClient(HttpClient&& other) noexcept
+    : h_(other.h_), multi_(other.multi_), share_(other.share_), max_connects_(other.max_connects_),
+      dns_pinned_(std::move(other.dns_pinned_)), resolve_(std::move(other.resolve_)),
+      connect_to_(std::move(other.connect_to_)), opt_(other.opt_), latency_(std::move(other.latency_)) {
+    other.h_ = nullptr;
+    other.multi_ = nullptr;
+    other.share_ = nullptr;
+}
+
+HttpClient& HttpClient::operator=(HttpClient&& other) noexcept {
+    if (this != &other) {
+        if (h_ && opt_.tls_sessions) opt_.tls_sessions->export_from(h_);
+        if (multi_) curl_multi_cleanup(multi_);
+        if (h_) curl_easy_cleanup(h_);
+        if (share_) curl_share_cleanup(share_);
+        h_ = other.h_;
+        multi_ = other.multi_;
+        share_ = other.share_;
+        max_connects_ = other.max_connects_;
+        dns_pinned_ = std::move(other.dns_pinned_);
+        resolve_ = std::move(other.resolve_);
+        connect_to_ = std::move(other.connect_to_);
+        opt_ = other.opt_;
+        latency_ = std::move(other.latency_);
+        other.h_ = nullptr;
+        other.multi_ = nullptr;
+        other.share_ = nullptr;
+    }
+    return *this;
+}
+
+void HttpClient::set_options(const Options& opt) {
+    const bool new_store = opt.tls_sessions && opt.tls_sessions != opt_.tls_sessions;
+    if (new_store && opt_.tls_sessions) opt_.tls_sessions->export_from(h_);
+    opt_ = opt;
+    apply_common_options();
+    if (new_store) opt_.tls_sessions->import_into(h_);
+}
+
+void HttpClient::apply_common_options() {
+    curl_easy_reset(h_);
+    // Basic callbacks
+    curl_easy_setopt(h_, CURLOPT_WRITEFUNCTION, &HttpClient::write_body_cb);
+    curl_easy_setopt(h_, CURLOPT_WRITEDATA, &acc_);
+    curl_easy_setopt(h_, CURLOPT_HEADERFUNCTION, &HttpClient::write_header_cb);
+    curl_easy_setopt(h_, CURLOPT_HEADERDATA, &acc_);
+
+    detail::apply_transfer_options(h_, opt_);
+    curl_easy_setopt(h_, CURLOPT_SHARE, share_);
+    // prewarm() can only raise the configured cache size
+    const long cache = std::max(max_connects_, opt_.max_idle_connections);
+    if (cache > 0) curl_easy_setopt(h_, CURLOPT_MAXCONNECTS, cache);
+    if (multi_) detail::apply_pool_options(multi_, opt_);
+}
+
+size_t HttpClient::write_body_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto t = static_cast<Transfer*>(userdata);
+    if (t->sink && t->status >= 200 && t->status < 300) {
+        t->control->state_->status = t->status;
+        t->control->state_->headers = &t->headers;
+        // Exceptions must not unwind through libcurl
+        try {
+            if (!(*t->sink)(std::string_view(ptr, size * nmemb), *t->control))
+                // A stopped transfer is never resumed; pausing it would hang
+                return t->control->stopped() ? 0 : CURL_WRITEFUNC_PAUSE;
+        } catch (...) {
+            t->sink_error = std::current_exception();
+            return 0;
+        }
+        t->streamed = true;
+        if (t->control->stopped()) return 0;
+    } else {
+        t->body.append(ptr, size * nmemb);
+    }
+    if (t->budget) {
+        // Pacing here slows the socket reads, so TCP flow control pushes back
+        // on the sender; a cancel ends the wait (and the transfer) at once
+        const auto pause = t->budget->charge(size * nmemb, t->priority);
+        if (pause.count() > 0 && t->cancel.wait_for(pause)) return 0;
+    }
+    return size * nmemb;
+}
+
+size_t HttpClient::write_header_cb(char* buffer, size_t size, size_t nitems, void* userdata) {
+    auto t = static_cast<Transfer*>(userdata);
+    const size_t total = size * nitems;
+    t->got_first_byte = true;
+    if (total > 5 && std::memcmp(buffer, "HTTP/", 5) == 0) {
+        const char* sp = static_cast<const char*>(std::memchr(buffer, ' ', total));
+        t->status = sp ? std::strtol(sp + 1, nullptr, 10) : 0;
+    }
+    detail::append_header_line(t->headers, buffer, total);
+    return total;
+}
+
+int HttpClient::xferinfo_cb(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    auto t = static_cast<Transfer*>(userdata);
+    if (t->cancel.cancelled()) {
+        t->abort_reason = "cancelled";
+        return 1;
+    }
+    if (t->first_byte_timeout_ms > 0 && !t->got_first_byte &&
+        std::chrono::steady_clock::now() - t->started > std::chrono::milliseconds(t->first_byte_timeout_ms)) {
+        t->abort_reason = "time to first byte exceeded";
+        return 1;
+    }
+    return 0;
+}
+
+void HttpClient::arm_transfer(CURL* h, Transfer& t, const Call& call) {
+    const auto now = std::chrono::steady_clock::now();
+    long timeout = opt_.timeout_ms;
+    long connect_timeout = opt_.connect_timeout_ms;
+    if (call.ro.deadline) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(*call.ro.deadline - now).count();
+        if (remaining <= 0) throw HttpError("deadline exceeded");
+        timeout = timeout > 0 ? std::min<long>(timeout, remaining) : static_cast<long>(remaining);
+        if (connect_timeout > 0) connect_timeout = std::min<long>(connect_timeout, remaining);
+    }
+    curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, timeout);
+    if (connect_timeout > 0) curl_easy_setopt(h, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout);
+    if (call.ro.max_recv_bps > 0)
+        curl_easy_setopt(h, CURLOPT_MAX_RECV_SPEED_LARGE, static_cast<curl_off_t>(call.ro.max_recv_bps));
+    if (call.ro.max_send_bps > 0)
+        curl_easy_setopt(h, CURLOPT_MAX_SEND_SPEED_LARGE, static_cast<curl_off_t>(call.ro.max_send_bps));
+
+    t.started = now;
+    t.first_byte_timeout_ms = opt_.first_byte_timeout_ms;
+    t.cancel = call.ro.cancel;
+    t.budget = opt_.download_budget.get();
+    t.priority = call.ro.priority;
+    t.sink = call.sink;
+    t.control = call.control;
+    const bool progress = t.first_byte_timeout_ms > 0 || t.cancel.valid();
+    curl_easy_setopt(h, CURLOPT_NOPROGRESS, progress ? 0L : 1L);
+    if (progress) {
+        curl_easy_setopt(h, CURLOPT_XFERINFOFUNCTION, &HttpClient::xferinfo_cb);
+        curl_easy_setopt(h, CURLOPT_XFERINFODATA, &t);
+    }
+}
+
+// Upper bound on how long perform_multi() sleeps while a progress check is armed
+static constexpr long kProgressTickMs = 20;
+
+static std::optional<long> retry_after_ms(const HeaderList& headers) {
+    if (auto v = find_header(headers, "Retry-After")) return parse_retry_after_ms(*v);
+    return std::nullopt;
+}
+
+CURLcode HttpClient::perform_multi(Call& call, long delay_ms, long& status) {
+    if (!multi_) {
+        multi_ = curl_multi_init();
+        if (!multi_) {
+            // No hedge, cancel wake-ups or resumable pauses; still a valid attempt
+            const CURLcode res = curl_easy_perform(h_);
+            if (res == CURLE_OK) curl_easy_getinfo(h_, CURLINFO_RESPONSE_CODE, &status);
+            return res;
+        }
+        detail::apply_pool_options(multi_, opt_);
+    }
+
+    // cancel() wakes curl_multi_poll() so the abort does not wait for socket activity
+    struct WakeOnCancel {
+        const CancellationToken& token;
+        uint64_t id;
+        ~WakeOnCancel() { token.remove_callback(id); }
+    } wake{call.ro.cancel, call.ro.cancel.add_callback([m = multi_]{ curl_multi_wakeup(m); })};
+    // Likewise StreamControl::resume(), for a paused stream
+    struct AttachStream {
+        const StreamControl* control;
+        ~AttachStream() { if (control) control->attach(nullptr); }
+    } attach{call.sink ? call.control : nullptr};
+    if (attach.control) attach.control->attach(multi_);
+
+    Transfer hedge_acc;
+    CURL* hedge = nullptr;
+    std::optional<ConcurrencyLimiter::Permit> hedge_permit;
+    std::optional<LoadBalancer::Pick> hedge_pick;
+    Slist hedge_connect_to;
+    std::chrono::steady_clock::time_point hedge_start;
+    int active = 1;
+    curl_multi_add_handle(multi_, h_);
+
+    auto finish = [&](CURL* winner, CURLcode res) {
+        curl_multi_remove_handle(multi_, h_);  // cancels the loser if still running
+        if (hedge) {
+            curl_multi_remove_handle(multi_, hedge);
+            if (winner == hedge && res == CURLE_OK) acc_ = std::move(hedge_acc);
+            if (res == CURLE_OK) curl_easy_getinfo(winner, CURLINFO_RESPONSE_CODE, &status);
+            curl_easy_cleanup(hedge);
+        } else if (res == CURLE_OK) {
+            curl_easy_getinfo(winner, CURLINFO_RESPONSE_CODE, &status);
+        }
+        if (hedge_pick && winner == hedge) {
+            // The hedge decided the outcome; the first attempt's address is left unreported
+            hedge_pick->record(res == CURLE_OK && status < 500, static_cast<long>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hedge_start).count()));
+            if (call.endpoint) call.endpoint->abandon();
+        }
+        return res;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        if (call.ro.cancel.cancelled()) {
+            acc_.abort_reason = "cancelled";
+            return finish(h_, CURLE_ABORTED_BY_CALLBACK);
+        }
+        // Unpausing must happen on the thread driving the transfer; curl may
+        // call the sink again from inside curl_easy_pause()
+        if (call.sink && call.control->take_resume()) curl_easy_pause(h_, CURLPAUSE_CONT);
+        int running = 0;
+        if (curl_multi_perform(multi_, &running) != CURLM_OK) return finish(h_, CURLE_FAILED_INIT);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            const CURLcode res = msg->data.result;
+            if (res == CURLE_OK || !hedge || --active == 0)
+                return finish(msg->easy_handle, res);
+            // One side failed while the other is still in flight; let the survivor finish
+            curl_multi_remove_handle(multi_, msg->easy_handle);
+            auto& failed = msg->easy_handle == hedge ? hedge_pick : call.endpoint;
+            if (failed) failed->record(false, 0);
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if (!hedge && elapsed >= delay_ms) {
+            // A hedge is an extra upstream request and must fit the rate limit
+            RateLimiter* rl = opt_.rate_limiter
+                ? opt_.rate_limiter->limiter_for(call.target().host, call.target().path) : nullptr;
+            // ...and only runs if the concurrency limit has a spare slot
+            if (opt_.concurrency_limiter) hedge_permit = opt_.concurrency_limiter->try_acquire(call.upstream());
+            const bool admitted = !opt_.concurrency_limiter || hedge_permit;
+            hedge = (admitted && (!rl || rl->try_acquire())) ? curl_easy_duphandle(h_) : nullptr;
+            if (hedge) {
+                try {
+                    arm_transfer(hedge, hedge_acc, call);
+                } catch (const HttpError&) {
+                    // Deadline already passed; the first attempt's own timeout handles it
+                    curl_easy_cleanup(hedge);
+                    hedge = nullptr;
+                }
+            }
+            if (hedge) {
+                // Send the hedge to another address when balancing, not after the slow one
+                if (call.endpoint) route(hedge, hedge_pick, call, hedge_connect_to);
+                hedge_start = std::chrono::steady_clock::now();
+                curl_easy_setopt(hedge, CURLOPT_WRITEDATA, &hedge_acc);
+                curl_easy_setopt(hedge, CURLOPT_HEADERDATA, &hedge_acc);
+                if (opt_.hedge.fresh_connection) curl_easy_setopt(hedge, CURLOPT_FRESH_CONNECT, 1L);
+                curl_multi_add_handle(multi_, hedge);
+                ++active;
+                continue;
+            }
+            delay_ms = LONG_MAX;  // not hedging after all; just wait for the first attempt
+        }
+
+        long wait_ms = hedge ? 1000 : static_cast<long>(std::max<long long>(1, delay_ms - elapsed));
+        // libcurl only runs the progress callback about once a second when the
+        // transfer is idle; wake more often so its checks fire on time
+        if (acc_.first_byte_timeout_ms > 0 && !acc_.got_first_byte) wait_ms = std::min(wait_ms, kProgressTickMs);
+        curl_multi_poll(multi_, nullptr, 0, static_cast<int>(std::min(wait_ms, 1000L)), nullptr);
+    }
+}
+
+void HttpClient::pin_dns(Call& call) {
+    auto pin = opt_.dns->lookup(call.target().host, call.target().port);
+    const std::string key = call.upstream();
+    // curl copies the entry into the (shared) DNS cache when the transfer
+    // starts, replacing older addresses; the option itself is cleared by the
+    // next curl_easy_reset
+    if (!pin) {
+        // Pins never expire inside curl. Once the DnsCache has let the host
+        // go (stale past stale_ms, or idle-evicted), remove ours so curl
+        // resolves it again instead of dialling old addresses forever.
+        auto it = dns_pinned_.find(key);
+        if (it == dns_pinned_.end()) return;
+        dns_pinned_.erase(it);
+        resolve_ = Slist{};
+        resolve_.add("-" + key);
+        curl_easy_setopt(h_, CURLOPT_RESOLVE, resolve_.ptr);
+        return;
+    }
+    uint64_t& loaded = dns_pinned_[key];
+    if (loaded == pin->generation) return;
+    resolve_ = Slist{};
+    resolve_.add(pin->resolve);
+    curl_easy_setopt(h_, CURLOPT_RESOLVE, resolve_.ptr);
+    loaded = pin->generation;
+}
+
+void HttpClient::route(CURL* h, std::optional<LoadBalancer::Pick>& pick, Call& call, Slist& list) {
+    const UrlParts& t = call.target();
+    pick = opt_.load_balancer->pick(t.host, t.port);
+    list = Slist{};
+    if (pick) list.add(call.upstream() + ":" + pick->address() + ":" + std::to_string(t.port));
+    curl_easy_setopt(h, CURLOPT_CONNECT_TO, list.ptr);
+}
+
+CURLcode HttpClient::perform_once(Call& call, long& status) {
+    acc_ = Transfer{};
+    status = 0;
+    if (call.ro.cancel.cancelled()) throw CancelledError("request cancelled");
+    // Limiter waits count against the deadline and end early on cancel
+    const auto wait_budget_ms = [&](long configured_ms) {
+        if (!call.ro.deadline) return configured_ms;
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            *call.ro.deadline - std::chrono::steady_clock::now()).count();
+        return static_cast<long>(std::clamp<long long>(left, 0, configured_ms));
+    };
+    const auto rejected = [&](long budget_ms, long configured_ms, const std::string& what) {
+        if (call.ro.cancel.cancelled()) throw CancelledError("request cancelled");
+        if (budget_ms < configured_ms) throw HttpError("deadline exceeded");
+        throw HttpError(what);
+    };
+    // Checked first so an open circuit costs neither rate-limit tokens nor a concurrency slot
+    std::optional<CircuitBreaker::Ticket> ticket;
+    if (opt_.circuit_breaker) {
+        ticket = opt_.circuit_breaker->admit(call.target().host);
+        if (!ticket) throw CircuitOpenError("circuit open for " + call.target().host);
+    }
+    if (opt_.rate_limiter) {
+        const long configured = opt_.rate_limiter->max_wait_ms();
+        const long budget = wait_budget_ms(configured);
+        if (!opt_.rate_limiter->acquire(call.target().host, call.target().path, budget, call.ro.cancel))
+            rejected(budget, configured, "rate limit exceeded for " + call.target().host);
+    }
+    std::optional<ConcurrencyLimiter::Permit> permit;
+    if (opt_.concurrency_limiter) {
+        const long configured = opt_.concurrency_limiter->max_queue_wait_ms();
+        const long budget = wait_budget_ms(configured);
+        permit = opt_.concurrency_limiter->acquire(call.upstream(), budget, call.ro.cancel);
+        if (!permit) rejected(budget, configured, "concurrency limit reached for " + call.upstream());
+    }
+
+    LatencyTracker& tracker = opt_.hedge.latency ? *opt_.hedge.latency : *latency_;
+
+    // Addresses are irrelevant when the transport is a Unix socket
+    const bool tcp = opt_.unix_socket_path.empty();
+    if (tcp && opt_.dns) pin_dns(call);
+    if (tcp && opt_.load_balancer) route(h_, call.endpoint, call, connect_to_);
+    arm_transfer(h_, acc_, call);
+    const auto start = std::chrono::steady_clock::now();
+    CURLcode res;
+    if (call.sink) {
+        // Needs a multi handle to resume paused transfers; never hedged
+        res = perform_multi(call, LONG_MAX, status);
+    } else if (call.idempotent && opt_.hedge.enabled) {
+        res = perform_multi(call, opt_.hedge.delay_ms(tracker), status);
+    } else if (acc_.first_byte_timeout_ms > 0 || call.ro.cancel.valid()) {
+        res = perform_multi(call, LONG_MAX, status);
+    } else {
+        res = curl_easy_perform(h_);
+        if (res == CURLE_OK) curl_easy_getinfo(h_, CURLINFO_RESPONSE_CODE, &status);
+    }
+    // A sink that threw or called stop() ended the transfer itself; the
+    // latter counts as a complete response
+    if (acc_.sink_error) std::rethrow_exception(acc_.sink_error);
+    if (res == CURLE_WRITE_ERROR && call.control && call.control->stopped()) {
+        res = CURLE_OK;
+        status = acc_.status;
+    }
+    // Cancellation is not a failure of the upstream: leave the permit and
+    // circuit ticket unreported
+    if (res != CURLE_OK && call.ro.cancel.cancelled()) throw CancelledError("request cancelled");
+    // A first-byte abort is a timeout as far as retries and callers are concerned
+    if (res == CURLE_ABORTED_BY_CALLBACK && acc_.abort_reason) res = CURLE_OPERATION_TIMEDOUT;
+    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (res == CURLE_OK) tracker.record(static_cast<long>(elapsed_us / 1000));
+    if (permit) {
+        if (res != CURLE_OK || status == 429 || status == 503) permit->dropped();
+        else permit->success(static_cast<long>(elapsed_us));
+    }
+    if (ticket) ticket->record(res == CURLE_OK && status < 500, static_cast<long>(elapsed_us / 1000));
+    if (call.endpoint) call.endpoint->record(res == CURLE_OK && status < 500, static_cast<long>(elapsed_us));
+    return res;
+}
+
+Response HttpClient::perform_with_headers_and_body(Call& call) {
+    const RetryPolicy& rp = opt_.retry;
+    const int max_attempts = (call.idempotent || rp.retry_non_idempotent) ? std::max(1, rp.max_attempts) : 1;
+    if (rp.budget) rp.budget->deposit();
+
+    for (int attempt = 1;; ++attempt) {
+        long code = 0;
+        const auto res = perform_once(call, code);
+
+        const bool retryable = res != CURLE_OK ? rp.is_retryable(res) : rp.is_retryable_status(code);
+        // Bytes a sink already took cannot be taken back
+        if (retryable && attempt < max_attempts && !acc_.streamed) {
+            long delay = rp.backoff_ms(attempt);
+            bool allowed = true;
+            if (res == CURLE_OK && rp.honor_retry_after) {
+                if (auto ra = retry_after_ms(acc_.headers)) {
+                    if (*ra > rp.max_retry_after_ms) allowed = false;
+                    else delay = *ra;
+                }
+            }
+            if (call.ro.deadline &&
+                std::chrono::steady_clock::now() + std::chrono::milliseconds(delay) >= *call.ro.deadline)
+                allowed = false;
+            // Budget is consulted last so a denied retry does not burn a token
+            if (allowed && (!rp.budget || rp.budget->try_withdraw())) {
+                if (call.ro.cancel.wait_for(std::chrono::milliseconds(delay)))
+                    throw CancelledError("request cancelled");
+                continue;
+            }
+        }
+
+        if (res != CURLE_OK) {
+            std::ostringstream oss;
+            oss << "curl_easy_perform failed: " << curl_easy_strerror(res);
+            if (acc_.abort_reason) oss << " (" << acc_.abort_reason << ")";
+            if (attempt > 1) oss << " (after " << attempt << " attempts)";
+            throw HttpError(oss.str());
+        }
+
+        Response r;
+        r.status = code;
+        r.body = std::move(acc_.body);
+        r.headers = std::move(acc_.headers);
+        return r;
+    }
+}
+
+Response HttpClient::get(const std::string& url,
+                         const std::vector<std::pair<std::string,std::string>>& headers,
+                         const RequestOptions& ro) {
+    if (opt_.coalescer || opt_.cache) return *get_shared(url, headers, ro);
+    return fetch_get(url, headers, ro);
+}
+
+SharedResponse HttpClient::get_shared(const std::string& url,
+                                      const std::vector<std::pair<std::string,std::string>>& headers,
+                                      const RequestOptions& ro) {
+    // Caller-supplied conditional requests are passed through untouched
+    if (!opt_.cache || find_header(headers, "If-None-Match") || find_header(headers, "If-Modified-Since"))
+        return fetch_shared(url, headers, ro);
+
+    auto cached = opt_.cache->lookup(url, headers);
+    if (cached) {
+        const auto now = CachedResponse::Clock::now();
+        if (cached->is_fresh(now)) return cached->response;
+        if (opt_.refresher && cached->usable_while_revalidating(now) && opt_.refresher->schedule(url, headers, cached->vary))
+            return cached->response;
+    }
+    return refresh_entry(url, headers, cached, ro);
+}
+
+SharedResponse HttpClient::revalidate(const std::string& url,
+                                      const std::vector<std::pair<std::string,std::string>>& headers,
+                                      const RequestOptions& ro) {
+    if (!opt_.cache) return get_shared(url, headers, ro);
+    return refresh_entry(url, headers, opt_.cache->lookup(url, headers), ro);
+}
+
+SharedResponse HttpClient::refresh_entry(const std::string& url,
+                                         const std::vector<std::pair<std::string,std::string>>& headers,
+                                         const SharedCachedResponse& cached,
+                                         const RequestOptions& ro) {
+    auto request_headers = headers;
+    if (cached) {
+        if (!cached->etag.empty()) request_headers.emplace_back("If-None-Match", cached->etag);
+        if (!cached->last_modified.empty()) request_headers.emplace_back("If-Modified-Since", cached->last_modified);
+    }
+
+    SharedResponse resp;
+    try {
+        resp = fetch_shared(url, request_headers, ro);
+    } catch (const HttpError&) {
+        if (cached && cached->usable_on_error(CachedResponse::Clock::now())) return cached->response;
+        throw;
+    }
+
+    if (cached && resp->status == 304) {
+        opt_.cache->store(url, ResponseCache::revalidated(*cached, *resp));
+        return cached->response;
+    }
+    if (cached && resp->status >= 500 && cached->usable_on_error(CachedResponse::Clock::now()))
+        return cached->response;
+    if (auto entry = ResponseCache::make_entry(resp, headers)) opt_.cache->store(url, std::move(entry));
+    else if (cached) opt_.cache->erase(url);
+    return resp;
+}
+
+SharedResponse HttpClient::fetch_shared(const std::string& url,
+                                        const std::vector<std::pair<std::string,std::string>>& headers,
+                                        const RequestOptions& ro) {
+    if (!opt_.coalescer) return std::make_shared<const Response>(fetch_get(url, headers, ro));
+    return opt_.coalescer->run(opt_.coalescer->make_key("GET", url, headers),
+                               [&]{ return fetch_get(url, headers, ro); }, ro.deadline, ro.cancel);
+}
+
+Response HttpClient::fetch_get(const std::string& url,
+                               const std::vector<std::pair<std::string,std::string>>& headers,
+                               const RequestOptions& ro) {
+    apply_common_options();
+    curl_easy_setopt(h_, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(h_, CURLOPT_URL, url.c_str());
+
+    Slist sl;
+    for (auto& [k,v] : headers) {
+        sl.add(k + ": " + v);
+    }
+    if (sl.ptr) curl_easy_setopt(h_, CURLOPT_HTTPHEADER, sl.ptr);
+
+    Call call(url, true, ro);
+    return perform_with_headers_and_body(call);
+}
+
+Response HttpClient::post(const std::string& url,
+                          std::string_view data,
+                          const std::vector<std::pair<std::string,std::string>>& headers,
+                          const RequestOptions& ro) {
+    apply_common_options();
+    curl_easy_setopt(h_, CURLOPT_POST, 1L);
+    curl_easy_setopt(h_, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(h_, CURLOPT_POSTFIELDS, data.data());
+    curl_easy_setopt(h_, CURLOPT_POSTFIELDSIZE, static_cast<long>(data.size()));
+
+    Slist sl;
+    for (auto& [k,v] : headers) {
+        sl.add(k + ": " + v);
+    }
+    if (sl.ptr) curl_easy_setopt(h_, CURLOPT_HTTPHEADER, sl.ptr);
+
+    Call call(url, false, ro);
+    return perform_with_headers_and_body(call);
+}
+
+Response HttpClient::stream(const std::string& url,
+                            BodySink sink,
+                            const std::vector<std::pair<std::string,std::string>>& headers,
+                            const RequestOptions& ro) {
+    apply_common_options();
+    curl_easy_setopt(h_, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(h_, CURLOPT_URL, url.c_str());
+
+    Slist sl;
+    for (auto& [k,v] : headers) {
+        sl.add(k + ": " + v);
+    }
+    if (sl.ptr) curl_easy_setopt(h_, CURLOPT_HTTPHEADER, sl.ptr);
+
+    StreamControl control;
+    Call call(url, true, ro);
+    call.sink = &sink;
+    call.control = &control;
+    return perform_with_headers_and_body(call);
+}
+
+Response HttpClient::stream_lines(const std::string& url,
+                                  const LineSplitter::Handler& on_record,
+                                  const std::vector<std::pair<std::string,std::string>>& headers,
+                                  const RequestOptions& ro,
+                                  size_t max_record_bytes) {
+    LineSplitter lines(max_record_bytes);
+    bool stopped = false;
+    Response r = stream(url, [&](std::string_view chunk, const StreamControl& control) {
+        if (!lines.feed(chunk, on_record)) {
+            stopped = true;
+            control.stop();
+        }
+        return true;
+    }, headers, ro);
+    if (!stopped && r.status >= 200 && r.status < 300) lines.finish(on_record);
+    return r;
+}
+
+static size_t discard_cb(char*, size_t size, size_t nmemb, void*) {
+    return size * nmemb;
+}
+
+size_t HttpClient::prewarm(const std::vector<std::string>& hosts, size_t connections_per_host) {
+    if (hosts.empty() || connections_per_host == 0) return 0;
+
+    // Origin URLs first, so a malformed host throws before anything is opened
+    std::vector<std::string> origins;
+    for (const auto& host : hosts) {
+        const std::string url = host.find("://") == std::string::npos ? "https://" + host : host;
+        const UrlParts parts = split_url(url);
+        const bool v6 = parts.host.find(':') != std::string::npos;
+        origins.push_back(parts.scheme + "://" + (v6 ? "[" + parts.host + "]" : parts.host) + ":" +
+                          std::to_string(parts.port) + "/");
+    }
+
+    // Warming past the per-host limit would only evict earlier warm connections
+    if (opt_.max_host_connections > 0)
+        connections_per_host = std::min(connections_per_host, static_cast<size_t>(opt_.max_host_connections));
+
+    CURLM* m = curl_multi_init();
+    if (!m) throw HttpError("curl_multi_init failed");
+    std::vector<CURL*> handles;
+    for (const auto& origin : origins) {
+        for (size_t i = 0; i < connections_per_host; ++i) {
+            CURL* e = curl_easy_init();
+            if (!e) continue;
+            detail::apply_transfer_options(e, opt_);
+            // A HEAD rather than CONNECT_ONLY: connect-only connections are
+            // never handed back to the cache for other transfers to reuse
+            curl_easy_setopt(e, CURLOPT_SHARE, share_);
+            curl_easy_setopt(e, CURLOPT_URL, origin.c_str());
+            curl_easy_setopt(e, CURLOPT_NOBODY, 1L);
+            curl_easy_setopt(e, CURLOPT_FOLLOWLOCATION, 0L);
+            curl_easy_setopt(e, CURLOPT_FRESH_CONNECT, 1L);
+            curl_easy_setopt(e, CURLOPT_WRITEFUNCTION, &discard_cb);
+            curl_easy_setopt(e, CURLOPT_HEADERFUNCTION, &discard_cb);
+            curl_multi_add_handle(m, e);
+            handles.push_back(e);
+        }
+    }
+
+    size_t warmed = 0;
+    int running = 0;
+    do {
+        curl_multi_perform(m, &running);
+        int left = 0;
+        while (CURLMsg* msg = curl_multi_info_read(m, &left)) {
+            // Any HTTP status will do: the point is the open connection
+            if (msg->msg == CURLMSG_DONE && msg->data.result == CURLE_OK) ++warmed;
+        }
+        if (running) curl_multi_poll(m, nullptr, 0, 1000, nullptr);
+    } while (running);
+
+    for (CURL* e : handles) {
+        curl_multi_remove_handle(m, e);
+        curl_easy_cleanup(e);
+    }
+    curl_multi_cleanup(m);
+
+    // Single transfers trim the cache to CURLOPT_MAXCONNECTS (5 by default)
+    max_connects_ = std::max<long>(max_connects_, static_cast<long>(warmed));
+    const long cache = std::max(max_connects_, opt_.max_idle_connections);
+    if (cache > 0) curl_easy_setopt(h_, CURLOPT_MAXCONNECTS, cache);
+    return warmed;
+}
+
+} // namespace net
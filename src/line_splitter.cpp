@@ -0,0 +1,45 @@
+#include "line_splitter.hpp"
+#include "response.hpp"
+
+namespace net {
+
+bool LineSplitter::feed(std::string_view chunk, const Handler& on_record) {
+    size_t pos = 0;
+    while (pos < chunk.size()) {
+        const size_t eol = chunk.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            if (partial_.size() + (chunk.size() - pos) > max_)
+                throw HttpError("line-delimited record longer than " + std::to_string(max_) + " bytes");
+            partial_.append(chunk.substr(pos));
+            return true;
+        }
+        bool go;
+        if (partial_.empty()) {
+            go = emit(chunk.substr(pos, eol - pos), on_record);
+        } else {
+            partial_.append(chunk.substr(pos, eol - pos));
+            go = emit(partial_, on_record);
+            partial_.clear();  // keeps the capacity for the next split record
+        }
+        if (!go) return false;
+        pos = eol + 1;
+    }
+    return true;
+}
+
+bool LineSplitter::finish(const Handler& on_record) {
+    if (partial_.empty()) return true;
+    const bool go = emit(partial_, on_record);
+    partial_.clear();
+    return go;
+}
+
+bool LineSplitter::emit(std::string_view record, const Handler& on_record) {
+    if (!record.empty() && record.back() == '\r') record.remove_suffix(1);
+    if (record.empty()) return true;
+    if (record.size() > max_)
+        throw HttpError("line-delimited record longer than " + std::to_string(max_) + " bytes");
+    return on_record(record);
+}
+
+} // namespace net
@@ -0,0 +1,204 @@
+#include "load_balancer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace net {
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadBalancer::Pool {
+    std::mutex mu;
+    std::vector<std::shared_ptr<Endpoint>> endpoints;
+    size_t next = 0;             // round-robin cursor
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    uint64_t dns_generation = 0;
+    bool fixed = false;          // set_endpoints() was called
+
+    uint64_t random() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    }
+};
+
+class LoadBalancer::Endpoint {
+public:
+    Endpoint(std::string address, Pool& pool, const Options& opt)
+        : address(std::move(address)), pool_(pool), opt_(opt) {}
+
+    const std::string address;
+    // The fields below are guarded by pool_.mu
+    int outstanding = 0;
+    double ewma_us = 0;          // 0 = no sample yet
+    int consecutive_failures = 0;
+    int ejections = 0;           // in a row; reset by a success
+    Clock::time_point ejected_until{};
+
+    bool ejected(Clock::time_point now) const { return now < ejected_until; }
+
+    // Lower is better: expected wait if we queue behind what is in flight
+    double score() const { return ewma_us * (outstanding + 1); }
+
+    void record(bool success, long latency_us) {
+        std::lock_guard<std::mutex> lk(pool_.mu);
+        --outstanding;
+        // A failure counts as slow, so a backend that errors quickly does not
+        // look attractive to PowerOfTwoChoices before it is ejected
+        const double sample = success ? static_cast<double>(latency_us)
+                                      : std::max(static_cast<double>(latency_us), ewma_us) * 2;
+        ewma_us = ewma_us == 0 ? sample : ewma_us + opt_.latency_alpha * (sample - ewma_us);
+        if (success) {
+            consecutive_failures = 0;
+            ejections = 0;
+            return;
+        }
+        if (++consecutive_failures < opt_.eject_after) return;
+
+        const auto now = Clock::now();
+        size_t out = 0;
+        for (const auto& ep : pool_.endpoints) out += ep->ejected(now) ? 1 : 0;
+        if (static_cast<double>(out + 1) > opt_.max_ejected_fraction * static_cast<double>(pool_.endpoints.size()))
+            return;
+        const long ms = std::min(opt_.max_eject_ms, opt_.eject_ms << std::min(ejections, 20));
+        ejected_until = now + std::chrono::milliseconds(ms);
+        ++ejections;
+        consecutive_failures = 0;
+    }
+
+    void abandon() {
+        std::lock_guard<std::mutex> lk(pool_.mu);
+        --outstanding;
+    }
+
+private:
+    Pool& pool_;
+    const Options& opt_;
+};
+
+namespace {
+
+// "host:port:addr1,addr2" from DnsCache -> {"addr1", "addr2"}
+std::vector<std::string> pinned_addresses(const std::string& resolve, size_t prefix_len) {
+    std::vector<std::string> out;
+    size_t pos = prefix_len;
+    while (pos < resolve.size()) {
+        size_t comma = resolve.find(',', pos);
+        if (comma == std::string::npos) comma = resolve.size();
+        if (comma > pos) out.push_back(resolve.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+} // namespace
+
+const std::string& LoadBalancer::Pick::address() const {
+    return ep_->address;
+}
+
+void LoadBalancer::Pick::record(bool success, long latency_us) {
+    if (ep_) std::exchange(ep_, nullptr)->record(success, latency_us);
+}
+
+void LoadBalancer::Pick::abandon() {
+    if (ep_) std::exchange(ep_, nullptr)->abandon();
+}
+
+LoadBalancer::LoadBalancer(Options opt, std::shared_ptr<DnsCache> dns)
+    : opt_(opt), dns_(dns ? std::move(dns) : std::make_shared<DnsCache>()) {}
+
+LoadBalancer::~LoadBalancer() = default;
+
+LoadBalancer::Pool& LoadBalancer::pool_for(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& slot = pools_[host + ":" + std::to_string(port)];
+    if (!slot) slot = std::make_unique<Pool>();
+    return *slot;
+}
+
+void LoadBalancer::reset_endpoints(Pool& pool, const std::vector<std::string>& addresses) {
+    std::vector<std::shared_ptr<Endpoint>> next;
+    next.reserve(addresses.size());
+    for (const auto& a : addresses) {
+        auto it = std::find_if(pool.endpoints.begin(), pool.endpoints.end(),
+                               [&](const std::shared_ptr<Endpoint>& ep) { return ep->address == a; });
+        next.push_back(it != pool.endpoints.end() ? *it : std::make_shared<Endpoint>(a, pool, opt_));
+    }
+    pool.endpoints = std::move(next);
+    pool.next = 0;
+}
+
+void LoadBalancer::set_endpoints(const std::string& host, int port, const std::vector<std::string>& addresses) {
+    Pool& pool = pool_for(host, port);
+    std::lock_guard<std::mutex> lk(pool.mu);
+    pool.fixed = true;
+    reset_endpoints(pool, addresses);
+}
+
+std::optional<LoadBalancer::Pick> LoadBalancer::pick(const std::string& host, int port) {
+    Pool& pool = pool_for(host, port);
+    std::lock_guard<std::mutex> lk(pool.mu);
+    if (!pool.fixed) {
+        if (auto pin = dns_->lookup(host, port); pin && pin->generation != pool.dns_generation) {
+            const size_t prefix = host.size() + 1 + std::to_string(port).size() + 1;
+            reset_endpoints(pool, pinned_addresses(pin->resolve, prefix));
+            pool.dns_generation = pin->generation;
+        }
+    }
+    const auto& eps = pool.endpoints;
+    if (eps.size() < 2) return std::nullopt;
+
+    const auto now = Clock::now();
+    std::vector<size_t> healthy;
+    healthy.reserve(eps.size());
+    for (size_t i = 0; i < eps.size(); ++i) {
+        if (!eps[i]->ejected(now)) healthy.push_back(i);
+    }
+    // Ejection is capped, so this only happens with a cap of 1.0; fail open
+    if (healthy.empty()) {
+        for (size_t i = 0; i < eps.size(); ++i) healthy.push_back(i);
+    }
+
+    const size_t n = healthy.size();
+    size_t chosen = 0;
+    switch (opt_.policy) {
+    case Policy::RoundRobin:
+        chosen = healthy[pool.next++ % n];
+        break;
+    case Policy::LeastOutstanding: {
+        // Scan from the cursor so ties rotate instead of piling onto the first
+        const size_t start = pool.next++;
+        chosen = healthy[start % n];
+        for (size_t i = 1; i < n; ++i) {
+            const size_t c = healthy[(start + i) % n];
+            if (eps[c]->outstanding < eps[chosen]->outstanding) chosen = c;
+        }
+        break;
+    }
+    case Policy::PowerOfTwoChoices: {
+        const size_t i = pool.random() % n;
+        const size_t j = n > 1 ? (i + 1 + pool.random() % (n - 1)) % n : i;
+        const Endpoint& a = *eps[healthy[i]];
+        const Endpoint& b = *eps[healthy[j]];
+        const bool first = a.score() < b.score() || (a.score() == b.score() && a.outstanding <= b.outstanding);
+        chosen = healthy[first ? i : j];
+        break;
+    }
+    }
+
+    ++eps[chosen]->outstanding;
+    return Pick(eps[chosen]);
+}
+
+size_t LoadBalancer::ejected(const std::string& host, int port) {
+    Pool& pool = pool_for(host, port);
+    std::lock_guard<std::mutex> lk(pool.mu);
+    const auto now = Clock::now();
+    size_t out = 0;
+    for (const auto& ep : pool.endpoints) out += ep->ejected(now) ? 1 : 0;
+    return out;
+}
+
+} // namespace net
@@ -0,0 +1,97 @@
+#include "rate_limiter.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace net {
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RateLimiter::RateLimiter(double rate_per_sec, double burst)
+    : interval_ns_(static_cast<int64_t>(1e9 / std::max(rate_per_sec, 1e-9))),
+      tolerance_ns_(static_cast<int64_t>(interval_ns_ * (std::max(burst, 1.0) - 1.0))) {}
+
+std::optional<std::chrono::nanoseconds> RateLimiter::reserve(std::chrono::nanoseconds max_wait) {
+    const int64_t now = now_ns();
+    int64_t tat = tat_.load(std::memory_order_relaxed);
+    for (;;) {
+        const int64_t base = std::max(tat, now);
+        const int64_t wait = std::max<int64_t>(0, base - tolerance_ns_ - now);
+        if (wait > max_wait.count()) return std::nullopt;
+        if (tat_.compare_exchange_weak(tat, base + interval_ns_, std::memory_order_relaxed))
+            return std::chrono::nanoseconds(wait);
+    }
+}
+
+HostRateLimiter::HostRateLimiter(Options opt)
+    : default_(opt.per_host_default),
+      max_wait_ms_(opt.max_wait_ms),
+      buckets_(new std::atomic<Node*>[kBuckets]) {
+    for (size_t i = 0; i < kBuckets; ++i) buckets_[i].store(nullptr, std::memory_order_relaxed);
+    for (auto& [key, limit] : opt.routes)
+        routes_.emplace_back(key, std::make_unique<RateLimiter>(limit.rate_per_sec, limit.burst));
+    std::stable_sort(routes_.begin(), routes_.end(),
+                     [](auto& a, auto& b){ return a.first.size() > b.first.size(); });
+}
+
+HostRateLimiter::~HostRateLimiter() {
+    for (size_t i = 0; i < kBuckets; ++i) {
+        Node* n = buckets_[i].load(std::memory_order_relaxed);
+        while (n) {
+            Node* next = n->next;
+            delete n;
+            n = next;
+        }
+    }
+}
+
+RateLimiter* HostRateLimiter::default_for(const std::string& host) {
+    auto& bucket = buckets_[std::hash<std::string>{}(host) % kBuckets];
+    Node* head = bucket.load(std::memory_order_acquire);
+    Node* fresh = nullptr;
+    for (;;) {
+        for (Node* n = head; n; n = n->next) {
+            if (n->host == host) {
+                delete fresh;
+                return &n->limiter;
+            }
+        }
+        if (!fresh) fresh = new Node(host, *default_, head);
+        else fresh->next = head;
+        // On failure head is reloaded and the new part of the chain rescanned
+        if (bucket.compare_exchange_weak(head, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+            return &fresh->limiter;
+    }
+}
+
+RateLimiter* HostRateLimiter::limiter_for(const std::string& host, const std::string& path) {
+    if (!routes_.empty()) {
+        const std::string key = host + path;
+        for (auto& [prefix, limiter] : routes_) {
+            if (key.compare(0, prefix.size(), prefix) == 0 &&
+                (key.size() == prefix.size() || prefix.size() == host.size() || key[prefix.size()] == '/' ||
+                 prefix.back() == '/'))
+                return limiter.get();
+        }
+    }
+    return default_ ? default_for(host) : nullptr;
+}
+
+bool HostRateLimiter::acquire(const std::string& host, const std::string& path) {
+    return acquire(host, path, max_wait_ms_, CancellationToken());
+}
+
+bool HostRateLimiter::acquire(const std::string& host, const std::string& path, long max_wait_ms,
+                              const CancellationToken& cancel) {
+    RateLimiter* rl = limiter_for(host, path);
+    if (!rl) return true;
+    auto wait = rl->reserve(std::chrono::milliseconds(std::min(max_wait_ms, max_wait_ms_)));
+    if (!wait) return false;
+    // A cancelled caller's slot stays spent; it has already been counted
+    if (wait->count() > 0) return !cancel.wait_for(*wait);
+    return true;
+}
+
+} // namespace net
@@ -0,0 +1,196 @@
+#include "reactor_http_client.hpp"
+#include "curl_common.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace net {
+
+struct ReactorHttpClient::Job : detail::AsyncTransfer {
+    uint64_t cancel_id = 0;
+    ~Job() {
+        if (cancel_id) req.ro.cancel.remove_callback(cancel_id);
+    }
+};
+
+ReactorHttpClient::ReactorHttpClient(Hooks hooks, Options opt)
+    : hooks_(std::move(hooks)), opt_(std::move(opt)), sched_(opt_.scheduler),
+      cancels_(std::make_shared<std::atomic<size_t>>(0)) {
+    if (!hooks_.watch || !hooks_.set_timer) throw HttpError("ReactorHttpClient needs watch and set_timer hooks");
+    detail::global_init_once();
+    if (opt_.max_in_flight == 0) opt_.max_in_flight = 1;
+    multi_ = curl_multi_init();
+    if (!multi_) throw HttpError("curl_multi_init failed");
+    detail::apply_pool_options(multi_, opt_.http);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, &ReactorHttpClient::socket_cb);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, &ReactorHttpClient::timer_cb);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this);
+}
+
+ReactorHttpClient::~ReactorHttpClient() {
+    closing_ = true;
+    const auto error = std::make_exception_ptr(HttpError("client destroyed before request completed"));
+    std::vector<JobPtr> dead;
+    sched_.remove_if([](const JobPtr&) { return true; }, [&](JobPtr j) { dead.push_back(std::move(j)); });
+    for (auto& kv : active_) {
+        curl_multi_remove_handle(multi_, kv.first);
+        dead.push_back(std::move(kv.second));
+    }
+    active_.clear();
+    for (auto& j : dead) fail(std::move(j), error);
+    curl_multi_cleanup(multi_);
+}
+
+int ReactorHttpClient::socket_cb(CURL*, curl_socket_t fd, int what, void* userp, void*) {
+    auto self = static_cast<ReactorHttpClient*>(userp);
+    int events = None;
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) events |= Read;
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) events |= Write;
+    self->hooks_.watch(fd, events);
+    return 0;
+}
+
+int ReactorHttpClient::timer_cb(CURLM*, long timeout_ms, void* userp) {
+    auto self = static_cast<ReactorHttpClient*>(userp);
+    if (timeout_ms < 0) self->curl_timer_at_.reset();
+    else self->curl_timer_at_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    self->arm_timer();
+    return 0;
+}
+
+void ReactorHttpClient::arm_timer() {
+    auto due = curl_timer_at_;
+    if (first_byte_due_ && (!due || *first_byte_due_ < *due)) due = first_byte_due_;
+    if (!due) {
+        hooks_.set_timer(-1);
+        return;
+    }
+    const auto left = *due - std::chrono::steady_clock::now();
+    hooks_.set_timer(std::max(0L, static_cast<long>(std::chrono::ceil<std::chrono::milliseconds>(left).count())));
+}
+
+void ReactorHttpClient::submit(AsyncRequest req, Completion done) {
+    auto job = std::make_unique<Job>();
+    job->req = std::move(req);
+    job->done = std::move(done);
+    if (closing_) {
+        fail(std::move(job), std::make_exception_ptr(HttpError("client is shutting down")));
+        return;
+    }
+    if (job->req.ro.cancel.valid()) {
+        job->cancel_id = job->req.ro.cancel.add_callback([c = cancels_, wake = hooks_.wake]{
+            c->fetch_add(1, std::memory_order_relaxed);
+            if (wake) wake();
+        });
+    }
+    const auto p = job->req.ro.priority;
+    sched_.push(std::move(job), p);
+    start_ready();
+}
+
+void ReactorHttpClient::on_socket(curl_socket_t fd, int events, bool error) {
+    int mask = 0;
+    if (events & Read) mask |= CURL_CSELECT_IN;
+    if (events & Write) mask |= CURL_CSELECT_OUT;
+    if (error) mask |= CURL_CSELECT_ERR;
+    int running = 0;
+    curl_multi_socket_action(multi_, fd, mask, &running);
+    reap();
+    if (cancels_->load(std::memory_order_relaxed) > 0 ||
+        (first_byte_due_ && *first_byte_due_ <= std::chrono::steady_clock::now()))
+        abort_cancelled();
+    start_ready();
+}
+
+void ReactorHttpClient::on_timeout() {
+    // The host timer is one-shot; curl reports a new timeout of its own
+    // through timer_cb while it runs below
+    if (curl_timer_at_ && *curl_timer_at_ <= std::chrono::steady_clock::now()) curl_timer_at_.reset();
+    int running = 0;
+    curl_multi_socket_action(multi_, CURL_SOCKET_TIMEOUT, 0, &running);
+    reap();
+    abort_cancelled();
+    start_ready();
+    arm_timer();
+}
+
+void ReactorHttpClient::abort_cancelled() {
+    cancels_->store(0, std::memory_order_relaxed);
+    const auto now = RequestOptions::Clock::now();
+    first_byte_due_.reset();
+    std::vector<JobPtr> dead;
+    sched_.remove_if([&](const JobPtr& j) { return j->cancelled() || j->expired(now); },
+                     [&](JobPtr j) { dead.push_back(std::move(j)); });
+    std::vector<JobPtr> slow;
+    for (auto it = active_.begin(); it != active_.end();) {
+        Job& j = *it->second;
+        if (j.cancelled() || j.first_byte_overdue(now)) {
+            curl_multi_remove_handle(multi_, it->first);
+            auto& to = j.cancelled() ? dead : slow;
+            to.push_back(std::move(it->second));
+            it = active_.erase(it);
+        } else {
+            if (j.first_byte_by && (!first_byte_due_ || *j.first_byte_by < *first_byte_due_))
+                first_byte_due_ = j.first_byte_by;
+            ++it;
+        }
+    }
+    for (auto& j : dead) {
+        if (j->cancelled()) fail(std::move(j), std::make_exception_ptr(CancelledError("request cancelled")));
+        else fail(std::move(j), std::make_exception_ptr(HttpError("deadline exceeded")));
+    }
+    for (auto& j : slow) fail(std::move(j), std::make_exception_ptr(HttpError("time to first byte exceeded")));
+}
+
+void ReactorHttpClient::start_ready() {
+    while (active_.size() < opt_.max_in_flight) {
+        auto next = sched_.pop();
+        if (!next) break;
+        JobPtr job = std::move(*next);
+        try {
+            detail::prepare_transfer(*job, opt_.http);
+        } catch (...) {
+            fail(std::move(job), std::current_exception());
+            continue;
+        }
+        CURL* h = job->h;
+        // Before adding: curl arms the timer from inside curl_multi_add_handle
+        if (job->first_byte_by && (!first_byte_due_ || *job->first_byte_by < *first_byte_due_))
+            first_byte_due_ = job->first_byte_by;
+        if (curl_multi_add_handle(multi_, h) != CURLM_OK) {
+            fail(std::move(job), std::make_exception_ptr(HttpError("curl_multi_add_handle failed")));
+            continue;
+        }
+        active_.emplace(h, std::move(job));
+    }
+}
+
+void ReactorHttpClient::reap() {
+    int left = 0;
+    while (CURLMsg* msg = curl_multi_info_read(multi_, &left)) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        CURL* h = msg->easy_handle;
+        const CURLcode res = msg->data.result;
+        auto it = active_.find(h);
+        if (it == active_.end()) continue;
+        auto job = std::move(it->second);
+        active_.erase(it);
+        curl_multi_remove_handle(multi_, h);
+        auto r = detail::transfer_result(*job, res);
+        auto done = std::move(job->done);
+        job.reset();
+        // May submit() more work; curl_multi_info_read stays valid across that
+        detail::deliver(std::move(done), std::move(r));
+    }
+}
+
+void ReactorHttpClient::fail(JobPtr job, std::exception_ptr error) {
+    auto done = std::move(job->done);
+    job.reset();
+    AsyncResult r;
+    r.error = std::move(error);
+    detail::deliver(std::move(done), std::move(r));
+}
+
+} // namespace net
@@ -0,0 +1,397 @@
+#include "response_cache.hpp"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+namespace net {
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+static std::string to_lower(std::string_view s) {
+    std::string out(s);
+    for (auto& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+// Splits a comma-separated header value into trimmed, non-empty tokens
+static std::vector<std::string_view> split_list(std::string_view value) {
+    std::vector<std::string_view> out;
+    while (!value.empty()) {
+        const auto comma = value.find(',');
+        auto item = trim(value.substr(0, comma));
+        if (!item.empty()) out.push_back(item);
+        if (comma == std::string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+    return out;
+}
+
+// Larger delta-seconds are clamped (RFC 9111 section 1.2.2). Low enough that
+// max_age_s plus a stale window still fits a 32-bit long (LLP64 targets).
+static constexpr int64_t kMaxDeltaSeconds = (int64_t{1} << 30) - 1;
+
+static std::optional<long> parse_seconds(std::string_view v) {
+    if (!v.empty() && v.front() == '"' && v.size() >= 2) v = v.substr(1, v.size() - 2);
+    if (v.empty() || !std::all_of(v.begin(), v.end(), [](char c){ return c >= '0' && c <= '9'; }))
+        return std::nullopt;
+    int64_t s = 0;
+    const auto r = std::from_chars(v.data(), v.data() + v.size(), s);
+    if (r.ec == std::errc::result_out_of_range) s = kMaxDeltaSeconds;
+    return static_cast<long>(std::min(s, kMaxDeltaSeconds));
+}
+
+CacheControl parse_cache_control(std::string_view value) {
+    CacheControl cc;
+    for (auto item : split_list(value)) {
+        const auto eq = item.find('=');
+        const auto name = to_lower(trim(item.substr(0, eq)));
+        const auto arg = eq == std::string_view::npos ? std::string_view{} : trim(item.substr(eq + 1));
+        if (name == "max-age") cc.max_age = parse_seconds(arg);
+        else if (name == "no-store") cc.no_store = true;
+        else if (name == "no-cache") cc.no_cache = true;
+        else if (name == "must-revalidate") cc.must_revalidate = true;
+        else if (name == "stale-while-revalidate") cc.stale_while_revalidate = parse_seconds(arg);
+        else if (name == "stale-if-error") cc.stale_if_error = parse_seconds(arg);
+    }
+    return cc;
+}
+
+bool CachedResponse::is_fresh(Clock::time_point now) const {
+    return !no_cache && now < stored_at + std::chrono::seconds(max_age_s);
+}
+
+bool CachedResponse::usable_while_revalidating(Clock::time_point now) const {
+    return !no_cache && now < stored_at + std::chrono::seconds(max_age_s + stale_while_revalidate_s);
+}
+
+bool CachedResponse::usable_on_error(Clock::time_point now) const {
+    return now < stored_at + std::chrono::seconds(max_age_s + stale_if_error_s);
+}
+
+bool CachedResponse::matches(const HeaderList& request_headers) const {
+    for (auto& [name, value] : vary) {
+        const std::string* v = find_header(request_headers, name);
+        if ((v ? *v : std::string()) != value) return false;
+    }
+    return true;
+}
+
+size_t CachedResponse::size_bytes() const {
+    size_t n = sizeof(CachedResponse) + response->body.size() + etag.size() + last_modified.size();
+    for (auto& [k,v] : response->headers) n += k.size() + v.size();
+    return n;
+}
+
+// Freshness lifetime, validators and age taken from a response's headers
+static void apply_response_headers(CachedResponse& e, const HeaderList& headers, CachedResponse::Clock::time_point now) {
+    CacheControl cc;
+    if (auto v = find_header(headers, "Cache-Control")) cc = parse_cache_control(*v);
+
+    e.no_cache = cc.no_cache;
+    // must-revalidate forbids serving stale content in any form
+    e.stale_while_revalidate_s = cc.must_revalidate ? 0 : cc.stale_while_revalidate.value_or(0);
+    e.stale_if_error_s = cc.must_revalidate ? 0 : cc.stale_if_error.value_or(0);
+    if (cc.max_age) {
+        e.max_age_s = *cc.max_age;
+    } else if (auto expires = find_header(headers, "Expires")) {
+        const time_t exp = curl_getdate(expires->c_str(), nullptr);
+        const auto date = find_header(headers, "Date");
+        const time_t base = date ? curl_getdate(date->c_str(), nullptr) : std::time(nullptr);
+        e.max_age_s = (exp != -1 && base != -1 && exp > base) ? static_cast<long>(std::min<int64_t>(exp - base, kMaxDeltaSeconds)) : 0;
+    } else {
+        e.max_age_s = 0;
+    }
+
+    long age = 0;
+    if (auto v = find_header(headers, "Age")) age = parse_seconds(*v).value_or(0);
+    e.stored_at = now - std::chrono::seconds(age);
+
+    if (auto v = find_header(headers, "ETag")) e.etag = *v;
+    if (auto v = find_header(headers, "Last-Modified")) e.last_modified = *v;
+}
+
+SharedCachedResponse ResponseCache::make_entry(SharedResponse resp, const HeaderList& request_headers) {
+    switch (resp->status) {
+        case 200: case 203: case 204: case 300: case 301: case 404: case 410: break;
+        default: return nullptr;
+    }
+    if (auto v = find_header(resp->headers, "Cache-Control"); v && parse_cache_control(*v).no_store)
+        return nullptr;
+
+    auto e = std::make_shared<CachedResponse>();
+    if (auto v = find_header(resp->headers, "Vary")) {
+        for (auto name : split_list(*v)) {
+            if (name == "*") return nullptr;
+            auto lname = to_lower(name);
+            const std::string* rv = find_header(request_headers, lname);
+            e->vary.emplace_back(std::move(lname), rv ? *rv : std::string());
+        }
+    }
+    apply_response_headers(*e, resp->headers, CachedResponse::Clock::now());
+    if (e->max_age_s <= 0 && !e->has_validators()) return nullptr;
+
+    e->response = std::move(resp);
+    return e;
+}
+
+SharedCachedResponse ResponseCache::revalidated(const CachedResponse& old, const Response& not_modified) {
+    auto e = std::make_shared<CachedResponse>(old);
+    // Validators missing from the 304 keep their stored values
+    e->etag.clear();
+    e->last_modified.clear();
+    apply_response_headers(*e, not_modified.headers, CachedResponse::Clock::now());
+    if (e->etag.empty()) e->etag = old.etag;
+    if (e->last_modified.empty()) e->last_modified = old.last_modified;
+    if (!find_header(not_modified.headers, "Cache-Control") && !find_header(not_modified.headers, "Expires")) {
+        e->max_age_s = old.max_age_s;
+        e->stale_while_revalidate_s = old.stale_while_revalidate_s;
+        e->stale_if_error_s = old.stale_if_error_s;
+        e->no_cache = old.no_cache;
+    }
+    return e;
+}
+
+// Disk tier metadata: everything in a CachedResponse except the body, as
+// native-endian fixed-width integers and u32-length-prefixed strings
+namespace {
+
+constexpr uint32_t kMetaVersion = 2;
+
+template <typename T>
+void put_int(std::string& out, T v) { out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+
+void put_str(std::string& out, std::string_view s) {
+    put_int<uint32_t>(out, static_cast<uint32_t>(s.size()));
+    out.append(s);
+}
+
+struct Reader {
+    std::string_view in;
+    bool ok = true;
+
+    template <typename T>
+    T get_int() {
+        T v{};
+        if (in.size() < sizeof v) { ok = false; return v; }
+        std::memcpy(&v, in.data(), sizeof v);
+        in.remove_prefix(sizeof v);
+        return v;
+    }
+    std::string get_str() {
+        const auto n = get_int<uint32_t>();
+        if (!ok || in.size() < n) { ok = false; return {}; }
+        std::string s(in.substr(0, n));
+        in.remove_prefix(n);
+        return s;
+    }
+    HeaderList get_headers() {
+        HeaderList out;
+        const auto n = get_int<uint32_t>();
+        for (uint32_t i = 0; ok && i < n; ++i) {
+            auto k = get_str();
+            auto v = get_str();
+            out.emplace_back(std::move(k), std::move(v));
+        }
+        return out;
+    }
+};
+
+void put_headers(std::string& out, const HeaderList& headers) {
+    put_int<uint32_t>(out, static_cast<uint32_t>(headers.size()));
+    for (auto& [k,v] : headers) { put_str(out, k); put_str(out, v); }
+}
+
+std::string encode_meta(const CachedResponse& e) {
+    std::string out;
+    put_int<uint32_t>(out, kMetaVersion);
+    put_int<int64_t>(out, std::chrono::duration_cast<std::chrono::milliseconds>(
+        e.stored_at.time_since_epoch()).count());
+    put_int<int64_t>(out, e.max_age_s);
+    put_int<int64_t>(out, e.stale_while_revalidate_s);
+    put_int<int64_t>(out, e.stale_if_error_s);
+    put_int<uint8_t>(out, e.no_cache ? 1 : 0);
+    put_str(out, e.etag);
+    put_str(out, e.last_modified);
+    put_headers(out, e.vary);
+    put_int<int64_t>(out, e.response->status);
+    put_headers(out, e.response->headers);
+    return out;
+}
+
+SharedCachedResponse decode_entry(std::string_view meta, std::string_view body) {
+    Reader r{meta};
+    if (r.get_int<uint32_t>() != kMetaVersion) return nullptr;
+    auto e = std::make_shared<CachedResponse>();
+    e->stored_at = CachedResponse::Clock::time_point(std::chrono::duration_cast<CachedResponse::Clock::duration>(
+        std::chrono::milliseconds(r.get_int<int64_t>())));
+    e->max_age_s = static_cast<long>(r.get_int<int64_t>());
+    e->stale_while_revalidate_s = static_cast<long>(r.get_int<int64_t>());
+    e->stale_if_error_s = static_cast<long>(r.get_int<int64_t>());
+    e->no_cache = r.get_int<uint8_t>() != 0;
+    e->etag = r.get_str();
+    e->last_modified = r.get_str();
+    e->vary = r.get_headers();
+    auto resp = std::make_shared<Response>();
+    resp->status = static_cast<long>(r.get_int<int64_t>());
+    resp->headers = r.get_headers();
+    if (!r.ok) return nullptr;
+    resp->body.assign(body.data(), body.size());
+    e->response = std::move(resp);
+    return e;
+}
+
+} // namespace
+
+ResponseCache::ResponseCache() : ResponseCache(Options{}) {}
+
+ResponseCache::ResponseCache(Options opt)
+    : shard_budget_(opt.max_bytes / std::max<size_t>(1, opt.shards)),
+      disk_(std::move(opt.disk)),
+      shards_(std::max<size_t>(1, opt.shards)) {}
+
+ResponseCache::Shard& ResponseCache::shard_for(const std::string& url) {
+    return shards_[std::hash<std::string>{}(url) % shards_.size()];
+}
+
+SharedCachedResponse ResponseCache::lookup(const std::string& url, const HeaderList& request_headers) {
+    SharedCachedResponse entry;
+    {
+        Shard& sh = shard_for(url);
+        std::lock_guard<std::mutex> lk(sh.mu);
+        auto it = sh.index.find(url);
+        if (it != sh.index.end()) {
+            sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+            entry = it->second->second;
+        } else if (auto big = sh.oversize.find(url); big != sh.oversize.end()) {
+            entry = big->second.lock();
+            if (!entry) sh.oversize.erase(big);
+        }
+    }
+    if (!entry && disk_) entry = load_from_disk(url);
+    return entry && entry->matches(request_headers) ? entry : nullptr;
+}
+
+SharedCachedResponse ResponseCache::load_from_disk(const std::string& url) {
+    auto hit = disk_->lookup(url);
+    if (!hit) return nullptr;
+    // Response owns its body, so this copies it out of the mapping once;
+    // later hits share the copy from memory
+    auto entry = decode_entry(hit->meta, hit->body);
+    if (!entry) {
+        disk_->erase(url);
+        return nullptr;
+    }
+    if (entry->size_bytes() <= shard_budget_) insert_memory(url, entry);
+    else hold_oversize(url, entry);
+    return entry;
+}
+
+void ResponseCache::hold_oversize(const std::string& url, const SharedCachedResponse& entry) {
+    Shard& sh = shard_for(url);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    sh.oversize[url] = entry;
+    if (sh.oversize.size() < sh.oversize_sweep_at) return;
+    for (auto it = sh.oversize.begin(); it != sh.oversize.end();) {
+        if (it->second.expired()) it = sh.oversize.erase(it);
+        else ++it;
+    }
+    sh.oversize_sweep_at = std::max<size_t>(16, 2 * sh.oversize.size());
+}
+
+void ResponseCache::evict_locked(Shard& sh) {
+    while (sh.bytes > shard_budget_ && !sh.lru.empty()) {
+        auto& victim = sh.lru.back();
+        sh.bytes -= victim.second->size_bytes();
+        sh.index.erase(victim.first);
+        sh.lru.pop_back();
+    }
+}
+
+SharedCachedResponse ResponseCache::insert_memory(const std::string& url, SharedCachedResponse entry) {
+    const size_t sz = entry->size_bytes();
+    SharedCachedResponse previous;
+    Shard& sh = shard_for(url);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    sh.oversize.erase(url);
+    auto it = sh.index.find(url);
+    if (it != sh.index.end()) {
+        sh.bytes -= it->second->second->size_bytes();
+        previous = std::exchange(it->second->second, std::move(entry));
+        sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+    } else {
+        sh.lru.emplace_front(url, std::move(entry));
+        sh.index.emplace(url, sh.lru.begin());
+    }
+    sh.bytes += sz;
+    evict_locked(sh);
+    return previous;
+}
+
+void ResponseCache::store(const std::string& url, SharedCachedResponse entry) {
+    if (disk_) {
+        // A revalidated entry shares its body with the one it replaces; only
+        // its metadata needs to reach the disk
+        SharedCachedResponse current;
+        {
+            Shard& sh = shard_for(url);
+            std::lock_guard<std::mutex> lk(sh.mu);
+            auto it = sh.index.find(url);
+            if (it != sh.index.end()) current = it->second->second;
+            else if (auto big = sh.oversize.find(url); big != sh.oversize.end()) current = big->second.lock();
+        }
+        const auto meta = encode_meta(*entry);
+        if (!(current && current->response == entry->response && disk_->update_meta(url, meta)))
+            disk_->put(url, meta, entry->response->body);
+    }
+    if (entry->size_bytes() > shard_budget_) {
+        erase_memory(url);
+        hold_oversize(url, entry);
+    } else {
+        insert_memory(url, std::move(entry));
+    }
+}
+
+void ResponseCache::erase(const std::string& url) {
+    if (disk_) disk_->erase(url);
+    erase_memory(url);
+}
+
+void ResponseCache::erase_memory(const std::string& url) {
+    Shard& sh = shard_for(url);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    sh.oversize.erase(url);
+    auto it = sh.index.find(url);
+    if (it == sh.index.end()) return;
+    sh.bytes -= it->second->second->size_bytes();
+    sh.lru.erase(it->second);
+    sh.index.erase(it);
+}
+
+size_t ResponseCache::size_bytes() const {
+    size_t n = 0;
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        n += sh.bytes;
+    }
+    return n;
+}
+
+size_t ResponseCache::entries() const {
+    size_t n = 0;
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        n += sh.lru.size();
+    }
+    return n;
+}
+
+} // namespace net
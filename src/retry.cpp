@@ -0,0 +1,83 @@
+#include "retry.hpp"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <random>
+
+namespace net {
+
+RetryBudget::RetryBudget() : RetryBudget(Options{}) {}
+
+RetryBudget::RetryBudget(Options opt)
+    : deposit_(static_cast<long long>(opt.ratio * kScale)),
+      capacity_(static_cast<long long>(opt.max_tokens * kScale)),
+      tokens_(capacity_) {}
+
+void RetryBudget::deposit() {
+    auto cur = tokens_.load(std::memory_order_relaxed);
+    while (cur < capacity_ &&
+           !tokens_.compare_exchange_weak(cur, std::min(capacity_, cur + deposit_),
+                                          std::memory_order_relaxed)) {
+    }
+}
+
+bool RetryBudget::try_withdraw() {
+    auto cur = tokens_.load(std::memory_order_relaxed);
+    while (cur >= kScale) {
+        if (tokens_.compare_exchange_weak(cur, cur - kScale, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+double RetryBudget::tokens() const {
+    return static_cast<double>(tokens_.load(std::memory_order_relaxed)) / kScale;
+}
+
+bool RetryPolicy::is_retryable(CURLcode code) const {
+    return std::find(retryable_curl_codes.begin(), retryable_curl_codes.end(), code)
+           != retryable_curl_codes.end();
+}
+
+bool RetryPolicy::is_retryable_status(long status) const {
+    return std::find(retryable_statuses.begin(), retryable_statuses.end(), status)
+           != retryable_statuses.end();
+}
+
+long RetryPolicy::backoff_ms(int attempt) const {
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    const double ceiling = std::min(static_cast<double>(max_backoff_ms),
+                                    initial_backoff_ms * std::pow(backoff_multiplier, attempt - 1));
+    if (ceiling <= 0) return 0;
+    std::uniform_int_distribution<long> dist(0, static_cast<long>(ceiling));
+    return dist(rng);
+}
+
+// long is 32 bits on LLP64 targets, so seconds are clamped before scaling
+static long seconds_to_ms(int64_t s) {
+    return static_cast<long>(std::min<int64_t>(s, LONG_MAX / 1000) * 1000);
+}
+
+std::optional<long> parse_retry_after_ms(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+    if (value.empty()) return std::nullopt;
+
+    if (std::all_of(value.begin(), value.end(), [](char c){ return c >= '0' && c <= '9'; })) {
+        int64_t s = 0;
+        const auto r = std::from_chars(value.data(), value.data() + value.size(), s);
+        // Too many digits for int64: further off than any cap a caller applies
+        return seconds_to_ms(r.ec == std::errc::result_out_of_range ? INT64_MAX : s);
+    }
+    // HTTP-date
+    const std::string date(value);
+    const time_t when = curl_getdate(date.c_str(), nullptr);
+    if (when == -1) return std::nullopt;
+    const time_t now = std::time(nullptr);
+    return when > now ? seconds_to_ms(static_cast<int64_t>(when - now)) : 0;
+}
+
+} // namespace net
@@ -0,0 +1,134 @@
+#include "singleflight.hpp"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <exception>
+
+namespace net {
+
+static std::string to_lower(std::string_view s) {
+    std::string out(s);
+    for (auto& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+RequestCoalescer::RequestCoalescer(std::vector<std::string> vary_headers) : vary_(std::move(vary_headers)) {
+    for (auto& v : vary_) v = to_lower(v);
+}
+
+RequestCoalescer::Shard& RequestCoalescer::shard_for(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % kShards];
+}
+
+std::string RequestCoalescer::make_key(std::string_view method, std::string_view url,
+                                       const std::vector<std::pair<std::string, std::string>>& headers) const {
+    std::vector<std::pair<std::string, std::string>> parts;
+    for (auto& [k,v] : headers) {
+        auto name = to_lower(k);
+        if (vary_.empty() || std::find(vary_.begin(), vary_.end(), name) != vary_.end())
+            parts.emplace_back(std::move(name), v);
+    }
+    std::sort(parts.begin(), parts.end());
+
+    std::string key;
+    key.append(method).append(" ").append(url);
+    for (auto& [k,v] : parts) key.append("\n").append(k).append(": ").append(v);
+    return key;
+}
+
+// One in-flight fetch. Finished with neither resp nor error when the leader's
+// failure was its own cancellation or deadline.
+struct RequestCoalescer::Call {
+    std::mutex mu;
+    std::condition_variable cv;
+    bool done = false;
+    SharedResponse resp;
+    std::exception_ptr error;
+};
+
+SharedResponse RequestCoalescer::follow(const std::shared_ptr<Call>& call,
+                                        std::optional<std::chrono::steady_clock::time_point> deadline,
+                                        const CancellationToken& cancel) {
+    // The callback holds its own reference: cancel() may still be running it
+    // after remove_callback() returns
+    const uint64_t wake = cancel.add_callback([call]{
+        std::lock_guard<std::mutex> lk(call->mu);
+        call->cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lk(call->mu);
+    const auto ready = [&]{ return call->done || cancel.cancelled(); };
+    if (deadline) call->cv.wait_until(lk, *deadline, ready);
+    else call->cv.wait(lk, ready);
+    const bool done = call->done;
+    lk.unlock();
+    cancel.remove_callback(wake);
+
+    if (!done) {
+        if (cancel.cancelled()) throw CancelledError("request cancelled");
+        throw HttpError("deadline exceeded waiting for coalesced request");
+    }
+    // Written before done was set and never again, so no lock needed
+    if (call->error) std::rethrow_exception(call->error);
+    return call->resp;
+}
+
+SharedResponse RequestCoalescer::run(const std::string& key, const std::function<Response()>& fetch,
+                                     std::optional<std::chrono::steady_clock::time_point> deadline,
+                                     const CancellationToken& cancel) {
+    Shard& sh = shard_for(key);
+    std::shared_ptr<Call> call;
+    for (;;) {
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lk(sh.mu);
+            auto& slot = sh.calls[key];
+            if (!slot) {
+                slot = std::make_shared<Call>();
+                leader = true;
+            }
+            call = slot;
+        }
+        if (leader) break;
+        if (auto resp = follow(call, deadline, cancel)) return resp;
+        // The leader gave up for its own reasons; take over or follow a new one
+    }
+
+    // Leader: unregister before publishing so a caller arriving after the
+    // result is ready starts a fresh fetch instead of reusing a finished one
+    auto publish = [&](SharedResponse resp, std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lk(sh.mu);
+            sh.calls.erase(key);
+        }
+        {
+            std::lock_guard<std::mutex> lk(call->mu);
+            call->resp = std::move(resp);
+            call->error = std::move(error);
+            call->done = true;
+        }
+        call->cv.notify_all();
+    };
+    try {
+        auto resp = std::make_shared<const Response>(fetch());
+        publish(resp, nullptr);
+        return resp;
+    } catch (...) {
+        // Per-attempt timeouts are clamped to whole milliseconds, so one that
+        // hit the deadline can fire just short of it
+        const bool own = cancel.cancelled() ||
+            (deadline && std::chrono::steady_clock::now() + std::chrono::milliseconds(1) >= *deadline);
+        publish(nullptr, own ? nullptr : std::current_exception());
+        throw;
+    }
+}
+
+size_t RequestCoalescer::in_flight() const {
+    size_t n = 0;
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        n += sh.calls.size();
+    }
+    return n;
+}
+
+} // namespace net
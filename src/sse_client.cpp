@@ -0,0 +1,202 @@
+#include "sse_client.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+
+namespace net {
+
+// ---- SseParser ----
+
+bool SseParser::feed(std::string_view chunk, const Handler& on_event) {
+    size_t pos = 0;
+    while (pos < chunk.size()) {
+        // "\r\n" is one terminator even when a chunk boundary splits it
+        if (skip_lf_) {
+            skip_lf_ = false;
+            if (chunk[pos] == '\n' && ++pos == chunk.size()) break;
+        }
+        const size_t eol = chunk.find_first_of("\r\n", pos);
+        if (eol == std::string_view::npos) {
+            if (partial_.size() + (chunk.size() - pos) > max_)
+                throw HttpError("SSE: line longer than " + std::to_string(max_) + " bytes");
+            partial_.append(chunk.substr(pos));
+            break;
+        }
+        skip_lf_ = chunk[eol] == '\r';
+        bool go;
+        if (partial_.empty()) {
+            go = line(chunk.substr(pos, eol - pos), on_event);
+        } else {
+            partial_.append(chunk.substr(pos, eol - pos));
+            go = line(partial_, on_event);
+            partial_.clear();
+        }
+        if (!go) return false;
+        pos = eol + 1;
+    }
+    return true;
+}
+
+void SseParser::reset() {
+    partial_.clear();
+    skip_lf_ = false;
+    first_line_ = true;
+    data_.clear();
+    event_type_.clear();
+    retry_set_ = false;
+}
+
+bool SseParser::line(std::string_view l, const Handler& on_event) {
+    if (first_line_) {
+        first_line_ = false;
+        if (l.size() >= 3 && std::memcmp(l.data(), "\xEF\xBB\xBF", 3) == 0) l.remove_prefix(3);
+    }
+
+    if (l.empty()) {
+        // Blank line: dispatch. An event without data lines is dropped.
+        const bool retry_set = retry_set_;
+        retry_set_ = false;
+        if (data_.empty()) {
+            event_type_.clear();
+            return true;
+        }
+        data_.pop_back();  // the '\n' after the last data line
+        ev_.id = last_id_;
+        ev_.event = event_type_.empty() ? "message" : event_type_;
+        ev_.data.swap(data_);
+        ev_.retry_ms = retry_set ? retry_ : std::nullopt;
+        data_.clear();
+        event_type_.clear();
+        return on_event(ev_);
+    }
+    if (l.front() == ':') return true;  // comment / keep-alive
+
+    std::string_view field = l, value;
+    if (const size_t colon = l.find(':'); colon != std::string_view::npos) {
+        field = l.substr(0, colon);
+        value = l.substr(colon + 1);
+        if (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+    }
+    if (field == "data") {
+        if (data_.size() + value.size() > max_)  // counts the joining '\n's
+            throw HttpError("SSE: event data longer than " + std::to_string(max_) + " bytes");
+        data_.append(value);
+        data_.push_back('\n');
+    } else if (field == "event") {
+        event_type_.assign(value);
+    } else if (field == "id") {
+        if (value.find('\0') == std::string_view::npos) last_id_.assign(value);
+    } else if (field == "retry") {
+        int64_t ms = 0;
+        const auto r = std::from_chars(value.data(), value.data() + value.size(), ms);
+        // Digits only (no sign); a value too large for int64 is ignored
+        if (!value.empty() && value.front() != '-' && r.ec == std::errc() && r.ptr == value.data() + value.size()) {
+            retry_ = static_cast<long>(std::min<int64_t>(ms, kMaxRetryMs));
+            retry_set_ = true;
+        }
+    }
+    return true;
+}
+
+// ---- SseClient ----
+
+static bool is_event_stream(const HeaderList& headers) {
+    const std::string* type = find_header(headers, "Content-Type");
+    return type && type->size() >= 17 && iequals(std::string_view(*type).substr(0, 17), "text/event-stream");
+}
+
+static HttpClient::Options stream_options(HttpClient::Options http) {
+    http.timeout_ms = 0;
+    return http;
+}
+
+SseClient::SseClient() : SseClient(Options{}) {}
+
+SseClient::SseClient(Options opt)
+    : opt_(std::move(opt)), http_(stream_options(opt_.http)), parser_(opt_.max_event_bytes) {}
+
+void SseClient::subscribe(const std::string& url,
+                          const std::function<bool(const SseEvent&)>& on_event,
+                          const std::vector<std::pair<std::string,std::string>>& headers,
+                          const RequestOptions& ro) {
+    int failures = 0;  // reconnects in a row without an event
+    for (;;) {
+        auto req_headers = headers;
+        req_headers.emplace_back("Accept", "text/event-stream");
+        req_headers.emplace_back("Cache-Control", "no-cache");
+        if (!parser_.last_event_id().empty()) req_headers.emplace_back("Last-Event-ID", parser_.last_event_id());
+
+        // The handler stops the stream through its own source; the caller's
+        // token is forwarded to it
+        CancellationSource stop;
+        const uint64_t link = ro.cancel.add_callback([stop]() mutable { stop.cancel(); });
+        RequestOptions attempt = ro;
+        attempt.cancel = stop.token();
+
+        bool stopped = false, got_event = false, checked = false;
+        std::exception_ptr too_big;  // an oversized event ends the subscription
+        std::optional<Response> resp;
+        parser_.reset();
+        try {
+            resp = http_.stream(url, [&](std::string_view chunk, const StreamControl& control) {
+                if (stopped) return true;  // drain whatever is left of this chunk
+                if (!checked) {
+                    // Never parse a body that is not an event stream; the
+                    // checks after stream() returns report it
+                    checked = true;
+                    if (control.status() != 200 || !is_event_stream(control.headers())) {
+                        control.stop();
+                        return true;
+                    }
+                }
+                bool go = false;
+                try {
+                    go = parser_.feed(chunk, [&](const SseEvent& e) {
+                        got_event = true;
+                        if (on_event(e)) return true;
+                        stopped = true;
+                        return false;
+                    });
+                } catch (const HttpError&) {
+                    too_big = std::current_exception();
+                }
+                if (!go) stop.cancel();
+                return true;
+            }, req_headers, attempt);
+        } catch (const CancelledError&) {
+            // Either stopped by the handler or by the caller; both end here
+        } catch (const HttpError&) {
+            // Connection failed or dropped; reconnect below
+        }
+        ro.cancel.remove_callback(link);
+        // Reconnecting would only replay it
+        if (too_big) std::rethrow_exception(too_big);
+        if (stopped || ro.cancel.cancelled()) return;
+        if (ro.deadline && RequestOptions::Clock::now() >= *ro.deadline) return;
+
+        if (resp) {
+            // 204 is the server asking us not to reconnect
+            if (resp->status == 204) return;
+            if (resp->status != 200) throw HttpError("SSE: unexpected status " + std::to_string(resp->status));
+            if (!is_event_stream(resp->headers)) throw HttpError("SSE: response is not text/event-stream");
+        }
+
+        if (got_event) failures = 0;
+        if (opt_.max_reconnects >= 0 && failures >= opt_.max_reconnects)
+            throw HttpError("SSE: giving up on " + url + " after " + std::to_string(failures) + " reconnects");
+        // Doubles per failure up to max_retry_ms, but never below the
+        // server's own retry time; saturates instead of overflowing
+        const long base = parser_.retry_ms().value_or(opt_.retry_ms);
+        long delay = base;
+        for (int i = 0; i < failures && delay < opt_.max_retry_ms; ++i)
+            delay = delay > opt_.max_retry_ms / 2 ? opt_.max_retry_ms : std::max(1L, delay * 2);
+        delay = std::max(base, std::min(delay, opt_.max_retry_ms));
+        ++failures;
+        if (ro.cancel.wait_for(std::chrono::milliseconds(delay))) return;
+    }
+}
+
+} // namespace net
@@ -0,0 +1,263 @@
+#include "tls_session_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x53534c54;  // "TLSS"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kRecordHeaderSize = 24;
+constexpr uint32_t kMaxField = 1u << 20;  // sanity bound for a torn / foreign file
+
+// key_len, shmac_len, data_len, checksum, valid_until (i64)
+struct RecordHeader {
+    uint32_t key_len = 0;
+    uint32_t shmac_len = 0;
+    uint32_t data_len = 0;
+    uint32_t checksum = 0;
+    int64_t valid_until = 0;
+};
+
+uint32_t fnv1a(uint32_t h, const void* data, size_t n) {
+    auto p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+uint32_t record_checksum(const RecordHeader& h, const std::string& key, const std::string& shmac,
+                         const std::string& data) {
+    uint32_t c = 2166136261u;
+    c = fnv1a(c, &h.key_len, sizeof h.key_len);
+    c = fnv1a(c, &h.shmac_len, sizeof h.shmac_len);
+    c = fnv1a(c, &h.data_len, sizeof h.data_len);
+    c = fnv1a(c, &h.valid_until, sizeof h.valid_until);
+    c = fnv1a(c, key.data(), key.size());
+    c = fnv1a(c, shmac.data(), shmac.size());
+    c = fnv1a(c, data.data(), data.size());
+    return c;
+}
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool expired(int64_t valid_until, int64_t now) {
+    return valid_until > 0 && valid_until <= now;
+}
+
+// Map key: the plain session key when curl provides one, else its salted hash
+std::string entry_id(const std::string& session_key, const std::string& shmac) {
+    return session_key.empty() ? "h:" + shmac : "k:" + session_key;
+}
+
+} // namespace
+
+TlsSessionStore::TlsSessionStore(Options opt) : opt_(std::move(opt)) {
+    load();
+}
+
+TlsSessionStore::~TlsSessionStore() {
+    save();
+}
+
+bool TlsSessionStore::supported() {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    // The API is present from 8.12 but only works when libcurl was built with
+    // it (otherwise CURLE_NOT_BUILT_IN), which shows as a feature name
+    static const bool built_in = [] {
+        const auto* info = curl_version_info(CURLVERSION_NOW);
+        if (!info || !info->feature_names) return false;
+        for (auto name = info->feature_names; *name; ++name) {
+            if (std::strcmp(*name, "SSLS-EXPORT") == 0) return true;
+        }
+        return false;
+    }();
+    return built_in;
+#else
+    return false;
+#endif
+}
+
+size_t TlsSessionStore::size() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return entries_.size();
+}
+
+void TlsSessionStore::load() {
+    if (opt_.path.empty()) return;
+    std::FILE* in = std::fopen(opt_.path.c_str(), "rb");
+    if (!in) return;
+    uint32_t file_hdr[2] = {0, 0};
+    if (std::fread(file_hdr, 1, sizeof file_hdr, in) != sizeof file_hdr ||
+        file_hdr[0] != kMagic || file_hdr[1] != kVersion) {
+        std::fclose(in);
+        return;
+    }
+
+    const int64_t now = unix_now();
+    std::lock_guard<std::mutex> lk(mu_);
+    for (;;) {
+        char raw[kRecordHeaderSize];
+        if (std::fread(raw, 1, kRecordHeaderSize, in) != kRecordHeaderSize) break;
+        RecordHeader h;
+        std::memcpy(&h.key_len, raw + 0, 4);
+        std::memcpy(&h.shmac_len, raw + 4, 4);
+        std::memcpy(&h.data_len, raw + 8, 4);
+        std::memcpy(&h.checksum, raw + 12, 4);
+        std::memcpy(&h.valid_until, raw + 16, 8);
+        if (h.key_len > kMaxField || h.shmac_len > kMaxField || h.data_len > kMaxField) break;
+
+        Entry e;
+        e.session_key.resize(h.key_len);
+        e.shmac.resize(h.shmac_len);
+        e.data.resize(h.data_len);
+        if (std::fread(e.session_key.data(), 1, h.key_len, in) != h.key_len ||
+            std::fread(e.shmac.data(), 1, h.shmac_len, in) != h.shmac_len ||
+            std::fread(e.data.data(), 1, h.data_len, in) != h.data_len)
+            break;
+        // Stop at the first bad record; everything after it is suspect
+        if (record_checksum(h, e.session_key, e.shmac, e.data) != h.checksum) break;
+        e.valid_until = h.valid_until;
+        if (expired(e.valid_until, now) || e.data.empty()) continue;
+        entries_[entry_id(e.session_key, e.shmac)] = std::move(e);
+    }
+    std::fclose(in);
+}
+
+// Creates path readable by the owner only. The mode is set by the create
+// itself, so there is no window in which another user can open the file, and
+// O_EXCL refuses anything (e.g. a symlink) planted at path in the meantime.
+static std::FILE* open_private(const std::string& path) {
+#ifdef _WIN32
+    const int fd = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (fd < 0) return nullptr;
+    std::FILE* f = ::_fdopen(fd, "wb");
+    if (!f) ::_close(fd);
+#else
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return nullptr;
+    std::FILE* f = ::fdopen(fd, "wb");
+    if (!f) ::close(fd);
+#endif
+    return f;
+}
+
+bool TlsSessionStore::save() const {
+    if (opt_.path.empty()) return false;
+    std::vector<const Entry*> keep;
+    std::lock_guard<std::mutex> lk(mu_);
+    const int64_t now = unix_now();
+    for (const auto& kv : entries_) {
+        if (!expired(kv.second.valid_until, now)) keep.push_back(&kv.second);
+    }
+    if (keep.size() > opt_.max_entries) {
+        // Unknown expiry (0) sorts last, i.e. is dropped first
+        std::sort(keep.begin(), keep.end(), [](const Entry* a, const Entry* b) {
+            const auto ka = a->valid_until ? a->valid_until : INT64_MIN;
+            const auto kb = b->valid_until ? b->valid_until : INT64_MIN;
+            return ka > kb;
+        });
+        keep.resize(opt_.max_entries);
+    }
+
+    const std::string tmp = opt_.path + ".tmp";
+    std::error_code ec;
+    std::filesystem::remove(tmp, ec);
+    std::FILE* out = open_private(tmp);
+    if (!out) return false;
+
+    const uint32_t file_hdr[2] = {kMagic, kVersion};
+    bool ok = std::fwrite(file_hdr, 1, sizeof file_hdr, out) == sizeof file_hdr;
+    for (const Entry* e : keep) {
+        if (!ok) break;
+        RecordHeader h;
+        h.key_len = static_cast<uint32_t>(e->session_key.size());
+        h.shmac_len = static_cast<uint32_t>(e->shmac.size());
+        h.data_len = static_cast<uint32_t>(e->data.size());
+        h.valid_until = e->valid_until;
+        h.checksum = record_checksum(h, e->session_key, e->shmac, e->data);
+        char raw[kRecordHeaderSize];
+        std::memcpy(raw + 0, &h.key_len, 4);
+        std::memcpy(raw + 4, &h.shmac_len, 4);
+        std::memcpy(raw + 8, &h.data_len, 4);
+        std::memcpy(raw + 12, &h.checksum, 4);
+        std::memcpy(raw + 16, &h.valid_until, 8);
+        ok = std::fwrite(raw, 1, kRecordHeaderSize, out) == kRecordHeaderSize &&
+             std::fwrite(e->session_key.data(), 1, e->session_key.size(), out) == e->session_key.size() &&
+             std::fwrite(e->shmac.data(), 1, e->shmac.size(), out) == e->shmac.size() &&
+             std::fwrite(e->data.data(), 1, e->data.size(), out) == e->data.size();
+    }
+    ok = std::fclose(out) == 0 && ok;
+    if (ok) std::filesystem::rename(tmp, opt_.path, ec);
+    if (!ok || ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+
+void TlsSessionStore::import_into(CURL* h) const {
+    if (!supported()) return;
+    std::lock_guard<std::mutex> lk(mu_);
+    const int64_t now = unix_now();
+    for (const auto& kv : entries_) {
+        const Entry& e = kv.second;
+        if (expired(e.valid_until, now)) continue;
+        curl_easy_ssls_import(h, e.session_key.empty() ? nullptr : e.session_key.c_str(),
+                              reinterpret_cast<const unsigned char*>(e.shmac.data()), e.shmac.size(),
+                              reinterpret_cast<const unsigned char*>(e.data.data()), e.data.size());
+    }
+}
+
+void TlsSessionStore::export_from(CURL* h) {
+    struct Sink {
+        std::vector<Entry> got;
+        static CURLcode cb(CURL*, void* userptr, const char* session_key, const unsigned char* shmac,
+                           size_t shmac_len, const unsigned char* sdata, size_t sdata_len,
+                           curl_off_t valid_until, int, const char*, size_t) {
+            Entry e;
+            if (session_key) e.session_key = session_key;
+            if (shmac) e.shmac.assign(reinterpret_cast<const char*>(shmac), shmac_len);
+            if (sdata) e.data.assign(reinterpret_cast<const char*>(sdata), sdata_len);
+            e.valid_until = static_cast<int64_t>(valid_until);
+            static_cast<Sink*>(userptr)->got.push_back(std::move(e));
+            return CURLE_OK;
+        }
+    } sink;
+    if (!supported()) return;
+    // Export outside the store lock: curl takes the share lock while iterating
+    if (curl_easy_ssls_export(h, &Sink::cb, &sink) != CURLE_OK) return;
+
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto& e : sink.got) {
+        if (e.data.empty() || (e.session_key.empty() && e.shmac.empty())) continue;
+        entries_[entry_id(e.session_key, e.shmac)] = std::move(e);
+    }
+}
+
+#else
+
+void TlsSessionStore::import_into(CURL*) const {}
+void TlsSessionStore::export_from(CURL*) {}
+
+#endif
+
+} // namespace net
@@ -0,0 +1,46 @@
+#include "url.hpp"
+#include "response.hpp"
+#include <curl/curl.h>
+#include <cctype>
+#include <cstdlib>
+
+namespace net {
+
+namespace {
+
+struct UrlHandle {
+    CURLU* h = curl_url();
+    ~UrlHandle() { if (h) curl_url_cleanup(h); }
+    UrlHandle() = default;
+    UrlHandle(const UrlHandle&) = delete;
+    UrlHandle& operator=(const UrlHandle&) = delete;
+
+    std::string part(CURLUPart what, unsigned flags = 0) const {
+        char* out = nullptr;
+        if (curl_url_get(h, what, &out, flags) != CURLUE_OK || !out) return {};
+        std::string s(out);
+        curl_free(out);
+        return s;
+    }
+};
+
+} // namespace
+
+UrlParts split_url(const std::string& url) {
+    UrlHandle u;
+    if (!u.h || curl_url_set(u.h, CURLUPART_URL, url.c_str(), 0) != CURLUE_OK)
+        throw HttpError("invalid URL: " + url);
+
+    UrlParts p;
+    p.scheme = u.part(CURLUPART_SCHEME);
+    p.host = u.part(CURLUPART_HOST);
+    if (p.host.size() >= 2 && p.host.front() == '[' && p.host.back() == ']')
+        p.host = p.host.substr(1, p.host.size() - 2);
+    for (auto& c : p.host) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    p.port = std::strtol(u.part(CURLUPART_PORT, CURLU_DEFAULT_PORT).c_str(), nullptr, 10);
+    p.path = u.part(CURLUPART_PATH);
+    if (p.path.empty()) p.path = "/";
+    return p;
+}
+
+} // namespace net
@@ -0,0 +1,67 @@
+// SseParser: event framing and the max_event_bytes cap
+#include "sse_client.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using net::SseEvent;
+using net::SseParser;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                      \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            std::fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                  \
+        }                                                                \
+    } while (0)
+
+static bool throws_http_error(SseParser& p, const std::string& chunk) {
+    try {
+        p.feed(chunk, [](const SseEvent&) { return true; });
+    } catch (const net::HttpError&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    {
+        // Split across chunks, CRLF split between them
+        SseParser p(64);
+        std::vector<SseEvent> got;
+        auto keep = [&](const SseEvent& e) { got.push_back(e); return true; };
+        CHECK(p.feed("id: 7\r", keep));
+        CHECK(p.feed("\nevent: tick\ndata: a", keep));
+        CHECK(p.feed("b\ndata: c\n\n", keep));
+        CHECK(got.size() == 1);
+        if (got.size() == 1) {
+            CHECK(got[0].id == "7");
+            CHECK(got[0].event == "tick");
+            CHECK(got[0].data == "ab\nc");
+        }
+    }
+    {
+        // An unterminated line may not grow past the cap
+        SseParser p(16);
+        CHECK(!throws_http_error(p, "data: 0123456789"));
+        CHECK(throws_http_error(p, "x"));
+    }
+    {
+        // Nor may an event's data, even when every line is short
+        SseParser p(16);
+        CHECK(!throws_http_error(p, "data: 0123456\n"));
+        CHECK(throws_http_error(p, "data: 012345678\n"));
+    }
+    {
+        // Exactly at the cap is accepted
+        SseParser p(8);
+        std::string data;
+        CHECK(!throws_http_error(p, "data:0123\ndata:456\n"));
+        CHECK(p.feed("\n", [&](const SseEvent& e) { data = e.data; return true; }));
+        CHECK(data == "0123\n456");
+    }
+    if (failures) std::fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}